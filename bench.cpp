@@ -0,0 +1,301 @@
+﻿#include "xml.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#ifdef XML_USE_POSIX
+#include <sys/resource.h>
+#endif
+using namespace std;
+
+//ベンチマーク (make bench)
+//合成したXMLで読み込み・書き出し・検索・破棄を計測し、1行に1つのJSONで結果を出力する
+//引数: [最大の大きさ(byte) デフォルト 16MB] [繰り返し回数 デフォルト 5]
+
+//メモリ確保の回数・大きさ (計測区間の差分を出力)
+static size_t g_allocs = 0;
+static size_t g_alloc_bytes = 0;
+
+//置き換えはすべて対にし、インライン展開させない (malloc・freeが見えると-Wmismatched-new-deleteの警告になる)
+#define BENCH_NOINLINE __attribute__((noinline))
+
+static BENCH_NOINLINE void* count_alloc(size_t size) noexcept {
+	++g_allocs;
+	g_alloc_bytes += size;
+	return malloc(size != 0 ? size : 1);
+}
+BENCH_NOINLINE void* operator new(size_t size) {
+	void* p = count_alloc(size);
+	if (p == nullptr) throw bad_alloc();
+	return p;
+}
+BENCH_NOINLINE void* operator new[](size_t size) { return operator new(size); }
+BENCH_NOINLINE void* operator new(size_t size, const nothrow_t&) noexcept { return count_alloc(size); }
+BENCH_NOINLINE void* operator new[](size_t size, const nothrow_t&) noexcept { return count_alloc(size); }
+BENCH_NOINLINE void operator delete(void* p) noexcept { free(p); }
+BENCH_NOINLINE void operator delete[](void* p) noexcept { free(p); }
+BENCH_NOINLINE void operator delete(void* p, size_t) noexcept { free(p); }
+BENCH_NOINLINE void operator delete[](void* p, size_t) noexcept { free(p); }
+BENCH_NOINLINE void operator delete(void* p, const nothrow_t&) noexcept { free(p); }
+BENCH_NOINLINE void operator delete[](void* p, const nothrow_t&) noexcept { free(p); }
+
+static long peak_rss_kb() { //最大常駐メモリ (KB)
+#ifdef XML_USE_POSIX
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) return usage.ru_maxrss;
+#endif
+	return 0;
+}
+
+//合成XMLの生成 (乱数は固定の種から作るため、同じ引数なら常に同じ文書になる)
+class corpus_generator {
+	uint64_t g_state;
+	string g_out;
+
+	uint32_t next() { //xorshift64*
+		g_state ^= g_state >> 12;
+		g_state ^= g_state << 25;
+		g_state ^= g_state >> 27;
+		return (uint32_t)((g_state * 2685821657736338717ULL) >> 32);
+	}
+	uint32_t range(uint32_t n) { return next() % n; }
+	void word() { //3~10文字の英小文字
+		uint32_t len = 3 + range(8);
+		for (uint32_t i = 0; i < len; i++) g_out += (char)('a' + range(26));
+	}
+	void words(uint32_t count) {
+		for (uint32_t i = 0; i < count; i++) {
+			if (i != 0) g_out += ' ';
+			word();
+		}
+	}
+	void wide(size_t size) { //ルートの直下に多数の小さい要素
+		g_out += "<root>\n";
+		while (g_out.size() < size) {
+			g_out += "\t<item id=\"" + to_string(range(1000000)) + "\">";
+			string tag = "f" + to_string(range(8));
+			g_out += "<" + tag + ">";
+			words(2);
+			g_out += "</" + tag + "></item>\n";
+		}
+		g_out += "</root>\n";
+	}
+	void deep(size_t size) { //深さ1000の入れ子を繰り返す
+		g_out += "<root>";
+		while (g_out.size() < size) {
+			for (int i = 0; i < 1000; i++) {
+				g_out += "<d";
+				g_out += to_string(i % 16);
+				g_out += " n=\"" + to_string(i) + "\">";
+			}
+			word();
+			for (int i = 999; i >= 0; i--) {
+				g_out += "</d";
+				g_out += to_string(i % 16);
+				g_out += ">";
+			}
+		}
+		g_out += "</root>";
+	}
+	void attribute(size_t size) { //1つの要素に多数の属性
+		g_out += "<root>\n";
+		while (g_out.size() < size) {
+			g_out += "\t<rec";
+			uint32_t count = 8 + range(16);
+			for (uint32_t i = 0; i < count; i++) {
+				g_out += " a" + to_string(i) + "=\"";
+				word();
+				g_out += "\"";
+			}
+			g_out += "/>\n";
+		}
+		g_out += "</root>\n";
+	}
+	void text(size_t size) { //長い内容
+		g_out += "<root>\n";
+		while (g_out.size() < size) {
+			g_out += "\t<p>";
+			words(50 + range(150));
+			g_out += "</p>\n";
+		}
+		g_out += "</root>\n";
+	}
+	void entity(size_t size) { //特殊文字を多く含む内容・属性値
+		static const char* const entities[] = { "&lt;", "&gt;", "&amp;", "&quot;", "&apos;", "&#65;", "&#x3042;" };
+		g_out += "<root>\n";
+		while (g_out.size() < size) {
+			g_out += "\t<e v=\"";
+			word();
+			g_out += entities[range(7)];
+			g_out += "\">";
+			for (int i = 0; i < 8; i++) {
+				word();
+				g_out += entities[range(7)];
+			}
+			g_out += "</e>\n";
+		}
+		g_out += "</root>\n";
+	}
+	void cdata(size_t size) { //CDATAと内容の混在
+		g_out += "<root>\n";
+		while (g_out.size() < size) {
+			g_out += "\t<c>";
+			words(3);
+			g_out += "<![CDATA[";
+			words(10);
+			g_out += " <&> ]]>";
+			words(2);
+			g_out += "</c>\n";
+		}
+		g_out += "</root>\n";
+	}
+public:
+	static const char* const kinds[];
+
+	string generate(const string& kind, size_t size) {
+		g_state = 0x9E3779B97F4A7C15ULL ^ (uint64_t)size;
+		g_out.clear();
+		g_out.reserve(size + 4096);
+		g_out += "<?xml version=\"1.0\"?>\n";
+		if (kind == "wide") wide(size);
+		else if (kind == "deep") deep(size);
+		else if (kind == "attribute") attribute(size);
+		else if (kind == "text") text(size);
+		else if (kind == "entity") entity(size);
+		else if (kind == "cdata") cdata(size);
+		return g_out;
+	}
+};
+const char* const corpus_generator::kinds[] = { "wide", "deep", "attribute", "text", "entity", "cdata" };
+
+//計測
+struct measure {
+	double best_ms;
+	size_t allocs, alloc_bytes; //最後の1回の確保
+};
+
+template <typename F>
+static measure run(int repeat, F f) { //f(計測開始, 計測終了)を繰り返して最短の時間を取得 (準備・後始末は計測区間の外で行う)
+	measure m = measure();
+	m.best_ms = 1e300;
+	for (int i = 0; i < repeat; i++) {
+		chrono::steady_clock::time_point start, stop;
+		size_t allocs = 0, bytes = 0;
+		f([&]() { allocs = g_allocs; bytes = g_alloc_bytes; start = chrono::steady_clock::now(); },
+		  [&]() { stop = chrono::steady_clock::now(); allocs = g_allocs - allocs; bytes = g_alloc_bytes - bytes; });
+		double ms = chrono::duration<double, milli>(stop - start).count();
+		if (ms < m.best_ms) m.best_ms = ms;
+		m.allocs = allocs;
+		m.alloc_bytes = bytes;
+	}
+	return m;
+}
+
+static void report(const string& corpus, size_t size, const char* bench, const measure& m, size_t bytes, size_t items) { //1行のJSON
+	double sec = m.best_ms / 1000.0;
+	printf("{\"corpus\":\"%s\",\"size\":%zu,\"bench\":\"%s\",\"ms\":%.3f,\"mb_per_s\":%.1f,\"items\":%zu,\"items_per_s\":%.0f,\"allocs\":%zu,\"alloc_bytes\":%zu,\"peak_rss_kb\":%ld}\n",
+		corpus.c_str(), size, bench, m.best_ms, sec > 0 ? bytes / sec / (1024.0 * 1024.0) : 0.0, items, sec > 0 ? items / sec : 0.0,
+		m.allocs, m.alloc_bytes, peak_rss_kb());
+	fflush(stdout);
+}
+
+static size_t count_nodes(xml_node<>* root) { //ノード数 (再帰せずにたどる)
+	size_t count = 0;
+	xml_node<>* node = root->first_child();
+	while (node != nullptr) {
+		++count;
+		if (node->first_child() != nullptr) { node = node->first_child(); continue; }
+		while (node != root && node->next_node() == nullptr) node = node->parent();
+		node = (node != root) ? node->next_node() : nullptr;
+	}
+	return count;
+}
+
+static void bench_corpus(const string& kind, size_t size, int repeat) {
+	corpus_generator gen;
+	string xml = gen.generate(kind, size);
+	size_t nodes;
+	{
+		xml_document<> doc(xml);
+		nodes = count_nodes(doc.get());
+	}
+
+	//読み込み
+	report(kind, xml.size(), "parse", run(repeat, [&](function<void()> start, function<void()> stop) {
+		xml_document<> doc;
+		start();
+		int err = doc.parse(xml);
+		stop();
+		if (err != 0) fprintf(stderr, "parse error %d (%s)\n", err, kind.c_str());
+	}), xml.size(), nodes);
+	report(kind, xml.size(), "parse_insitu", run(repeat, [&](function<void()> start, function<void()> stop) {
+		xml_document<> doc;
+		string copy = xml;
+		start();
+		doc.parse_insitu(std::move(copy));
+		stop();
+	}), xml.size(), nodes);
+
+	xml_document<> doc(xml);
+	//書き出し
+	size_t out_size = doc.print(true).size();
+	report(kind, xml.size(), "print_indent", run(repeat, [&](function<void()> start, function<void()> stop) {
+		start();
+		string out = doc.print(true);
+		stop();
+	}), out_size, nodes);
+	out_size = doc.print(false).size();
+	report(kind, xml.size(), "print", run(repeat, [&](function<void()> start, function<void()> stop) {
+		start();
+		string out = doc.print(false);
+		stop();
+	}), out_size, nodes);
+
+	//属性の検索 (各要素のすべての属性名で検索)
+	vector<pair<xml_node<>*, string>> attrs;
+	vector<pair<xml_node<>*, string>> children; //子ノードと、最後の子ノードの名前
+	xml_node<>* root = doc.get();
+	xml_node<>* node = root->first_child();
+	while (node != nullptr) {
+		for (size_t i = 0; i < node->attribute_size(); i++) attrs.push_back(make_pair(node, node->attribute(i)->name()));
+		if (node->end_child() != nullptr && node->end_child()->type() == normal) children.push_back(make_pair(node, node->end_child()->name()));
+		if (node->first_child() != nullptr) { node = node->first_child(); continue; }
+		while (node != root && node->next_node() == nullptr) node = node->parent();
+		node = (node != root) ? node->next_node() : nullptr;
+	}
+	size_t found = 0;
+	report(kind, xml.size(), "find_attribute", run(repeat, [&](function<void()> start, function<void()> stop) {
+		start();
+		for (const pair<xml_node<>*, string>& a : attrs) found += a.first->find_attribute(a.second) != nullptr;
+		stop();
+	}), 0, attrs.size());
+	//名前つきの子ノードの検索 (末尾の子ノードの名前を先頭から検索 2回目以降は索引を利用)
+	report(kind, xml.size(), "first_child_named", run(repeat, [&](function<void()> start, function<void()> stop) {
+		start();
+		for (const pair<xml_node<>*, string>& c : children) found += c.first->first_child(c.second) != nullptr;
+		stop();
+	}), 0, children.size());
+	if (found == 0 && !attrs.empty()) fprintf(stderr, "lookup failed (%s)\n", kind.c_str());
+
+	//破棄
+	report(kind, xml.size(), "destroy", run(repeat, [&](function<void()> start, function<void()> stop) {
+		xml_document<> d(xml);
+		start();
+		d.clear();
+		stop();
+	}), xml.size(), nodes);
+}
+
+int main(int argc, char* argv[]) {
+	size_t max_size = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 16 * 1024 * 1024;
+	int repeat = (argc > 2) ? atoi(argv[2]) : 5;
+	if (repeat < 1) repeat = 1;
+	for (size_t size = 64 * 1024; size <= max_size; size *= 16) {
+		for (const char* kind : corpus_generator::kinds) bench_corpus(kind, size, repeat);
+	}
+	return 0;
+}
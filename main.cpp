@@ -39,6 +39,21 @@ int main() {
 	an->delete_attribute("Add2");
 	delete an->next_node();
 
+	//別のドキュメントから属性を移動 (移動元を破棄しても移動後の属性は利用できる)
+	xml_attribute<>* moved;
+	{
+		xml_document<> src;
+		src.parse_insitu("<src from=\"other document\"/>");
+		moved = src.get()->first_child()->find_attribute("from")->move(an);
+	}
+	cout << moved->name() << " " << moved->value() << endl;
+
+	//子ノードの後のCDATA (既定では-1、parse_no_cdataでは読み飛ばして0)
+	xml_document<> cdata;
+	int cdata_default = cdata.parse("<r><x>1</x><![CDATA[q]]>t</r>");
+	int cdata_skip = cdata.parse<parse_no_cdata>("<r><x>1</x><![CDATA[q]]>t</r>");
+	cout << cdata_default << " " << cdata_skip << endl;
+
 	//書き出し
 	ofstream ofs("out.xml");
 	ofs << doc.print();
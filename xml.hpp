@@ -1,828 +1,3897 @@
-/*! xml.hpp v0.1 | CC0 1.0 (https://creativecommons.org/publicdomain/zero/1.0/deed) */
-
-#ifndef _XML_HPP
-#define _XML_HPP
-
-#include <map>
-#include <string>
-#include <iostream>
-using namespace std;
-
-template <typename T> class xml_node;
-template <typename T> class xml_attribute;
-template <typename T> class xml_document;
-
-enum xml_obj_type {
-	none,
-	attribute,
-	node
-};
-
-enum xml_node_type {
-	document, //名前なし 属性なし 子ノードあり xmlドキュメントのトップ
-	doctype,  //名前なし 属性なし 子ノードなし 
-	comment,  //名前なし 属性なし 子ノードなし 
-	normal,   //名前あり 属性あり 子ノードあり 通常のノード
-	pi        //名前なし 属性なし 子ノードなし 
-};
-
-template <typename T = char>
-class xml_object {
-protected:
-	string o_name;
-	string o_value;
-	xml_node<T>* n_parent;
-public:
-	xml_object() {}
-	virtual ~xml_object() {}
-
-	virtual xml_obj_type obj_type() { return none; }
-	xml_node<T>* parent() { return n_parent; }
-	virtual string name() { return o_name; }
-	virtual void name(const string& text) { o_name = text; }
-	virtual string value() { return o_value; }
-	virtual void value(const string& text) { o_value = text; }
-};
-
-template <typename T = char>
-class xml_attribute : public xml_object<T> {
-	using xml_object<T>::o_name;
-	using xml_object<T>::o_value;
-	using xml_object<T>::n_parent;
-
-	void set_parent() { //親ノードに自分を登録
-		xml_attribute<T>* attr = n_parent->find_attribute(o_name);
-		if (attr != nullptr && attr != this) {
-			//既に別の属性が存在する場合それを削除
-			attr->n_parent = nullptr;
-			delete attr;
-		}
-		n_parent->a_list[o_name] = this;
-	}
-
-	friend class xml_node<T>;
-public:
-	xml_attribute() { n_parent = nullptr; }
-	xml_attribute(const string& n, const string& v) { o_name = n; o_value = v; n_parent = nullptr; }
-	xml_attribute(const string& n, const string& v, xml_node<T>* parent) { //親ノードに自分を登録
-		o_name = n;
-		o_value = v;
-		n_parent = parent;
-		set_parent();
-	}
-	~xml_attribute() { clear_parent(); }
-
-	xml_obj_type obj_type() { return attribute; }
-
-	void clear_parent() {
-		if (n_parent != nullptr) {
-			//親ノードの登録を削除
-			n_parent->a_list.erase(o_name);
-			n_parent = nullptr;
-		}
-	}
-
-	void move(xml_node<T>* node) {
-		clear_parent();
-		if (node != nullptr) {
-			n_parent = node;
-			set_parent();
-		}
-	}
-
-	string name() { return o_name; }
-	void name(const string& text) {
-		if (n_parent == nullptr) o_name = text;
-		else {
-			//現在の登録を削除
-			n_parent->a_list.erase(o_name);
-			o_name = text;
-			set_parent();
-		}
-	}
-
-	string value() { return o_value; }
-	void value(const string& text) { o_value = text; }
-};
-
-template <typename T = char>
-class xml_node : public xml_object<T> {
-	using xml_object<T>::o_name;
-	using xml_object<T>::o_value;
-	using xml_object<T>::n_parent;
-
-	xml_node_type n_type;
-	map<string, xml_attribute<T>*> a_list;
-
-	xml_node<T>* n_back;
-	xml_node<T>* n_next;
-	xml_node<T>* n_first;
-	xml_node<T>* n_end;
-
-	friend class xml_attribute<T>;
-	friend class xml_document<T>;
-public:
-	xml_node() { n_back = nullptr; n_next = nullptr; n_parent = nullptr; n_first = nullptr; n_end = nullptr; n_type = normal; }
-	xml_node(xml_node_type t) { n_back = nullptr; n_next = nullptr; n_parent = nullptr; n_first = nullptr; n_end = nullptr; n_type = t; }
-	xml_node(const string& n, const string& v) {
-		o_name = n;
-		o_value = v;
-		n_type = normal;
-		n_back = nullptr;
-		n_next = nullptr;
-		n_parent = nullptr;
-		n_first = nullptr;
-		n_end = nullptr;
-	}
-	xml_node(const string& n, const string& v, xml_node_type t, xml_node<T>* node, int flag = 1) {
-		n_type = t;
-		switch (t) {
-			case comment: case doctype: case pi:
-				o_value = v;
-				break;
-			case normal:
-				o_name = n;
-				o_value = v;
-				break;
-			default: break;
-		}
-		n_first = nullptr;
-		n_end = nullptr;
-		if (flag <= 1) {
-			//nodeを親ノードとして登録
-			n_parent = node;
-			if (n_parent->n_first == nullptr) {
-				//親ノードに登録しているノードが一つもない
-				n_parent->n_first = this;
-				n_parent->n_end = this;
-				n_back = nullptr;
-				n_next = nullptr;
-			} else if (flag <= 0) {
-				// -0 最前列に追加
-				n_parent->n_first->n_back = this;
-				n_back = nullptr;
-				n_next = n_parent->n_first;
-				n_parent->n_first = this;
-			} else {
-				// 1 最後尾に追加
-				n_parent->n_end->n_next = this;
-				n_back = n_parent->n_end;
-				n_next = nullptr;
-				n_parent->n_end = this;
-			}
-		} else if (node->n_parent != nullptr) {
-			//nodeの前後に自分を配置
-			n_parent = node->n_parent;
-			if (flag == 2) {
-				// 2 nodeの前に配置
-				if (node->n_next == nullptr) {
-					//最後尾に配置
-					n_parent->n_end = this;
-					node->n_next = this;
-					n_back = node;
-					n_next = nullptr;
-				} else {
-					n_back = node;
-					n_next = node->n_next;
-					n_back->n_next = this;
-					n_next->n_back = this;
-				}
-			} else {
-				// 3- nodeの後ろに配置
-				if (node->n_back == nullptr) {
-					//最前列に配置
-					n_parent->n_first = this;
-					node->n_back = this;
-					n_back = nullptr;
-					n_next = node;
-				} else {
-					n_back = node->n_back;
-					n_next = node;
-					n_back->n_next = this;
-					n_next->n_back = this;
-				}
-			}
-		}
-	}
-	~xml_node() { clear(); }
-
-	void clear() {
-		delete_all_children(); //子ノードをすべて削除
-		delete_all_attribute(); //属性をすべて削除
-		//親ノードとのリンクをクリア
-		if (n_parent != nullptr) {
-			if (n_parent->first_child() == this) n_parent->n_first = n_next;
-			if (n_parent->end_child() == this) n_parent->n_end = n_back;
-		}
-		//前後のつながりを修正
-		if (n_back != nullptr) {
-			if (n_next != nullptr) {
-				n_back->n_next = n_next;
-				n_next->n_back = n_back;
-			} else n_back->n_next = nullptr;
-		} else if (n_next != nullptr) n_next->n_back = nullptr;
-	}
-
-	//取得・編集
-	xml_node_type type() { return n_type; }
-	void type(xml_node_type t) {
-		n_type = t;
-		if (t == document) delete_all_attribute();
-		else if (t == comment || t == doctype) {
-			delete_all_children();
-			delete_all_attribute();
-		}
-	}
-	xml_obj_type obj_type() { return node; }
-	string name() { return o_name; }
-	void name(const string& n) { if (n_type == normal || n_type == pi) o_name = n; }
-	string value() { return o_value; }
-	void value(const string& v) { if (n_type == normal || n_type == comment || n_type == doctype) o_value = v; }
-	void add_value(const string& v) { if (n_type == normal || n_type == comment || n_type == doctype) o_value += v; }
-	//子ノード取得
-	xml_node<T>* first_child() {
-		if (n_type == document || n_type == normal) return n_first; //子ノードが存在するタイプのみ
-		return nullptr;
-	}
-	xml_node<T>* first_child(const string& n) {
-		if (n_type == document || n_type == normal) { //子ノードが存在するタイプのみ
-			//検索
-			xml_node<T>* find_node = n_first;
-			while (find_node != nullptr) {
-				if (find_node->o_name == n) return find_node; //タグ名が一致するか判定
-				find_node = find_node->n_next; //次のノード
-			}
-		}
-		return nullptr;
-	}
-	xml_node<T>* end_child() {
-		if (n_type == document || n_type == normal) return n_end; //子ノードが存在するタイプのみ
-		return nullptr;
-	}
-	xml_node<T>* end_child(const string& n) {
-		if (n_type == document || n_type == normal) { //子ノードが存在するタイプのみ
-			//検索
-			xml_node<T>* find_node = n_end;
-			while (find_node != nullptr) {
-				if (find_node->o_name == n) return find_node; //タグ名が一致するか判定
-				find_node = find_node->n_back; //前のノード
-			}
-		}
-		return nullptr;
-	}
-	//次のノード取得
-	xml_node<T>* next_node() { return n_next; }
-	xml_node<T>* next_node(const string& n) {
-		xml_node<T>* find_node = n_next;
-		while (find_node != nullptr) {
-			if (find_node->o_name == n) return find_node; //タグ名が一致するか判定
-			find_node = find_node->n_next; //次のノード
-		}
-		return nullptr;
-	}
-	//前のノード取得
-	xml_node<T>* back_node() { return n_back; }
-	xml_node<T>* back_node(const string& n) {
-		xml_node<T>* find_node = n_back;
-		while (find_node != nullptr) {
-			if (find_node->o_name == n) return find_node; //タグ名が一致するか判定
-			find_node = find_node->n_back; //前のノード
-		}
-		return nullptr;
-	}
-	//属性取得
-	xml_attribute<T>* first_attribute() {
-		if ((n_type == normal || n_type == pi) && !a_list.empty()) return a_list.begin()->second;
-		return nullptr;
-	}
-	xml_attribute<T>* end_attribute() {
-		if ((n_type == normal || n_type == pi) && !a_list.empty()) return a_list.end()->second;
-		return nullptr;
-	}
-	xml_attribute<T>* find_attribute(const string& n) { //指定の属性を検索して取得
-		if ((n_type == normal || n_type == pi) && !a_list.empty()) { //属性が存在
-			auto it = a_list.find(n); //検索
-			if (it != a_list.end()) return it->second; //指定の属性が存在
-		}
-		return nullptr;
-	}
-	//追加
-	xml_node<T>* add_first_child(const string& n, const string& v, xml_node_type t = normal) {
-		xml_node<T>* out = new xml_node<T>(n, v, t, this, 0);
-		return out;
-	}
-	xml_node<T>* add_end_child(const string& n, const string& v, xml_node_type t = normal) {
-		xml_node<T>* out = new xml_node<T>(n, v, t, this, 1);
-		return out;
-	}
-	xml_node<T>* add_next_node(const string& n, const string& v, xml_node_type t = normal) {
-		xml_node<T>* out = new xml_node<T>(n, v, t, this, 2);
-		return out;
-	}
-	xml_node<T>* add_back_node(const string& n, const string& v, xml_node_type t = normal) {
-		xml_node<T>* out = new xml_node<T>(n, v, t, this, 3);
-		return out;
-	}
-	xml_attribute<T>* add_attribute(const string& n, const string& v) {
-		if (n_type != normal && n_type != pi) return nullptr;
-		xml_attribute<T>* attr = find_attribute(n);
-		if (attr != nullptr) attr->value(v); //既に存在する属性に上書き
-		else attr = new xml_attribute<T>(n, v, this); //新規作成
-		return attr;
-	}
-	//ノード削除
-	xml_node<T>* delete_first_child() {
-		if (n_type != normal && n_type != document) return nullptr;
-		xml_node<T>* out = nullptr;
-		xml_node<T>* node = n_first;
-		if (node->type() != document && node != nullptr) { out = node->next_node(); delete node; }
-		return out;
-	}
-	xml_node<T>* delete_first_child(const string& n) {
-		if (n_type != normal && n_type != document) return nullptr;
-		xml_node<T>* out = nullptr;
-		xml_node<T>* node = n_first;
-		//検索
-		while (node != nullptr) {
-			if ((node->type() == normal || node->type() == pi) && node->name() == n) { out = node->next_node(); delete node; break; }
-			node = node->next_node();
-		}
-		return out;
-	}
-	xml_node<T>* delete_end_child() {
-		if (n_type != normal && n_type != document) return nullptr;
-		xml_node<T>* out = nullptr;
-		xml_node<T>* node = n_end;
-		if (node->type() != document && node != nullptr) { out = node->back_node(); delete node; }
-		return out;
-	}
-	xml_node<T>* delete_end_child(const string& n) {
-		if (n_type != normal && n_type != document) return nullptr;
-		xml_node<T>* out = nullptr;
-		xml_node<T>* node = n_end;
-		//検索
-		while (node != nullptr) {
-			if ((node->type() == normal || node->type() == pi) && node->name() == n) { out = node->back_node(); delete node; break; }
-			node = node->back_node();
-		}
-		return out;
-	}
-	void delete_all_children() { //子ノードをすべて削除
-		if ((n_type != normal && n_type != document) || n_first == nullptr) return;
-		xml_node<T>* node = n_first;
-		while (1) {
-			if (node->next_node() == nullptr) {
-				delete node;
-				break;
-			} else {
-				node = node->next_node();
-				delete node->back_node();
-			}
-		}
-		n_first = nullptr;
-		n_end = nullptr;
-	}
-	xml_node<T>* delete_next_node() {
-		if (n_type == document || n_next == nullptr) return nullptr;
-		xml_node<T>* out = n_next->next_node();
-		delete n_next;
-		return out;
-	}
-	xml_node<T>* delete_next_node(const string& n) {
-		xml_node<T>* out = nullptr;
-		xml_node<T>* node = n_next;
-		//検索
-		while (node != nullptr) {
-			if ((node->type() == normal || node->type() == pi) && node->name() == n) { out = node->next_node(); delete node; break; }
-			node = node->next_node();
-		}
-		return out;
-	}
-	xml_node<T>* delete_back_node() {
-		if (n_type == document || n_back == nullptr) return nullptr;
-		xml_node<T>* out = n_back->back_node();
-		delete n_back;
-		return out;
-	}
-	xml_node<T>* delete_back_node(const string& n) {
-		xml_node<T>* out = nullptr;
-		xml_node<T>* node = n_back;
-		//検索
-		while (node != nullptr) {
-			if ((node->type() == normal || node->type() == pi) && node->name() == n) { out = node->back_node(); delete node; break; }
-			node = node->back_node();
-		}
-		return out;
-	}
-	//属性削除
-	void delete_attribute(const string& n) { //指定した属性を削除
-		if (a_list.empty()) return;
-		xml_attribute<T>* attr = find_attribute(n);
-		if (attr != nullptr) {
-			delete attr;
-			a_list.erase(n);
-		}
-	}
-	void delete_all_attribute() { //属性をすべて削除
-		if (a_list.empty()) return;
-		for (auto it : a_list) {
-			it.second->n_parent = nullptr;
-			delete it.second;
-		}
-		a_list.clear();
-	}
-};
-
-template <typename T = char>
-class xml_document {
-	xml_node<T> doc;
-
-	inline int espape_decode(const string& xml, size_t& pos, string& value) {
-		if      (xml.compare(pos+1, 3, "lt;")   == 0) { value += '<';  pos += 4; } //&lt; <
-		else if (xml.compare(pos+1, 3, "gt;")   == 0) { value += '>';  pos += 4; } //&gt; >
-		else if (xml.compare(pos+1, 4, "amp;")  == 0) { value += '&';  pos += 5; } //&amp; &
-		else if (xml.compare(pos+1, 5, "quot;") == 0) { value += '\"'; pos += 6; } //&quot; "
-		else if (xml.compare(pos+1, 1, "#")     == 0) { //Unicode
-			unsigned int utf32;
-			int numflag = 0;
-			string numstr = "";
-			if (xml.compare(pos+2, 1, "x") == 0) {
-				//&#xN~N; (16進数表記) N=0~f
-				pos += 3;
-				while (numflag == 0) {
-					switch (xml[pos]) {
-						case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
-						case 'a': case 'b': case 'c': case 'd': case 'e': case 'f':
-						case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
-							numstr += xml[pos];
-							break;
-						case ';': numflag = 1; break;
-						default: return -1;
-					}
-					++pos;
-				}
-				utf32 = stoul(numstr, nullptr, 16);
-			} else {
-				//&#N~N; (10進数表記) N=0~9
-				pos += 2;
-				while (numflag == 0) {
-					switch (xml[pos]) {
-						case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
-							numstr += xml[pos];
-							break;
-						case ';': numflag = 1; break;
-						default: return -1;
-					}
-					++pos;
-				}
-				utf32 = stoul(numstr, nullptr, 10);
-			}
-			if (utf32 <= 0x007F) { //1byte
-				value += (char)utf32;
-			} else if (utf32 >= 0x0080 && utf32 <= 0x07FF) { //2byte
-				value += (char)(0xC0 | ((utf32 & 0x7C0) >> 6));
-				value += (char)(0x80 |  (utf32 & 0x3F));
-			} else if (utf32 >= 0x0800 && utf32 <= 0xFFFF) { //3byte
-				value += (char)(0xE0 | ((utf32 & 0xF000) >> 12));
-				value += (char)(0x80 | ((utf32 & 0xFC0) >> 6));
-				value += (char)(0x80 |  (utf32 & 0x3F));
-			} else if (utf32 >= 0x10000 && utf32 <= 0x1FFFFF) { //4byte
-				value += (char)(0xF0 | ((utf32 & 0x1C0000) >> 18));
-				value += (char)(0x80 | ((utf32 & 0x3F000) >> 12));
-				value += (char)(0x80 | ((utf32 & 0xFC0) >> 6));
-				value += (char)(0x80 |  (utf32 & 0x3F));
-			}
-		} else return -3;
-		return 0;
-	}
-	//読み込み処理
-	int parse_type(const string& xml, size_t& pos, xml_node<T>* parent) {
-		int err = 0;
-		if (xml[pos] == '/') { ++pos; err = 1; } //終了タグ
-		else if (xml[pos] == '!') {
-			if (pos+2 < xml.size() && xml[pos+1] == '-' && xml[pos+2] == '-')  { pos += 3; err = parse_comment(xml, pos, parent); }
-			else if (xml.compare(pos+1, 8, "DOCTYPE ") == 0) { pos += 9; err = parse_doctype(xml, pos, parent); }
-			else err = -1; //該当タグなし
-		} else if (xml[pos] == '?') { ++pos; err = parse_pi(xml, pos, parent); }
-		else { err = parse_node(xml, pos, parent); }
-		return err;
-	}
-	int parse_name(const string& xml, size_t& pos, string& out) {
-		out = "";
-		//タグ名
-		while(pos < xml.size()) {
-			switch (xml[pos]) {
-				case ' ': case '\t': case '\n':
-					++pos;
-					if (out.empty()) return -3; //名前が存在しない
-					return 0; //属性処理・内容処理
-				case '=':
-					++pos;
-					if (out.empty()) return -3; //名前が存在しない
-					return 3;
-				case '>':
-					++pos;
-					return 1; //内容処理
-				case '/':
-					if (xml[pos+1] != '>') return -1;
-					pos += 2;
-					if (out.empty()) return -3; //名前が存在しない
-					return 2; // "/>" ノード処理終了
-				case '?':
-					if (xml[pos+1] != '>') return -1;
-					pos += 2;
-					return 4; //pi終了
-				case ';': case ':': case ',': case '&':
-					return -2; //禁止文字
-				default:
-					out += xml[pos];
-					break;
-			}
-			++pos;
-		}
-		return -1;
-	}
-	int parse_attribute(const string& xml, size_t& pos, xml_node<T>* node) {
-		string attr_name;
-		string attr_value;
-		int err;
-		//属性
-		int attr_mode = 0; //0 = name, 1=equal, 2=value_1, 3=value_2
-		while (pos < xml.size()) {
-			//終了判定
-			if (xml[pos] == '>') {
-				if (attr_name.empty() == false) return -1; //作成途中の属性がある
-				++pos;
-				return 0;
-			} else if (xml[pos] == '/') {
-				if (xml[pos+1] != '>') return -1;
-				if (attr_name.empty() == false) return -1; //作成途中の属性がある
-				pos += 2;
-				return 2; // "/>" ノード処理終了
-			}
-
-			//処理
-			if (attr_mode == 0) {
-				//空白を省略
-				switch (xml[pos]) {
-					case ' ': case '\t': case '\n': ++pos; break;
-					default: attr_mode = 1; break;
-				}
-			} else if (attr_mode == 1) {
-				//name
-				err = parse_name(xml, pos, attr_name);
-				if (err < 0) return -1; //属性名の取得に失敗
-				else if (err == 3) attr_mode = 3; // '=' が存在
-				else if (err == 0) attr_mode = 2;
-				else return err;
-			} else if (attr_mode == 2) {
-				// = が見つかるまで進める
-				switch (xml[pos]) {
-					case '=': attr_mode = 3; break; //次のモードに移行
-					case ' ': case '\t': case '\n': break; //空白文字を省略
-					default: return -3; //禁止文字
-				}
-				++pos;
-			} else if (attr_mode == 3) {
-				// " が見つかるまで進める
-				switch (xml[pos]) {
-					case '\"': attr_mode = 4; break; //次のモードに移行
-					case ' ': case '\t': case '\n': break; //空白文字を省略
-					default: return -3; //禁止文字
-				}
-				++pos;
-			} else if (attr_mode == 4) {
-				//value
-				switch (xml[pos]) {
-					case '\"':
-						node->add_attribute(attr_name, attr_value); //属性登録
-						attr_name = ""; attr_value = ""; //リセット
-						attr_mode = 0; //最初に戻る
-						break;
-					case '&':
-						//特殊文字
-						err = espape_decode(xml, pos, attr_value);
-						if (err < 0) return err;
-						break;
-					default:
-						attr_value += xml[pos];
-						break;
-				}
-				++pos;
-			}
-		}
-		return -1;
-	}
-	int parse_node(const string& xml, size_t& pos, xml_node<T>* parent) { //<name>value</name>
-		/*----------開始タグ----------*/
-		string node_name;
-		int err = parse_name(xml, pos, node_name);
-		if (err == 2) { parent->add_end_child(node_name, ""); return 0; } // "/>"
-		else if (err < 0)  return err;
-		else if (err == 3) return -3;
-		else if (err == 4) return -4; //pi
-		//ノード作成
-		xml_node<T>* node = parent->add_end_child(node_name, "");
-		if (err == 0) {
-			err = parse_attribute(xml, pos, node);
-			if (err < 0) return err;
-			else if (err == 2) return 0;
-		}
-		/*----------開始タグ----------*/
-		//内容
-		string node_value;
-		size_t end_tag;
-		// "<"が見つかるまで繰り返し
-		int value_flag = 0;
-		while (1) {
-			if (pos >= xml.size()) return -1;
-			if (xml[pos] == '<') {
-				if (xml.compare(pos+1, 8, "![CDATA[") == 0) {
-					//<![CDATA[]]>
-					pos += 9;
-					end_tag = xml.find("]]>", pos); // "]]>"を検索
-					if (end_tag == string::npos) return -1; //タグの終端が存在しない
-					node_value += xml.substr(pos, end_tag-pos); //内容を切り取り
-					pos = end_tag + 3;
-					value_flag = 1;
-				} else { ++pos; break; }
-			} else if (xml[pos] == '&') {
-				//特殊文字
-				err = espape_decode(xml, pos, node_value);
-				if (err < 0) return err;
-				value_flag = 1;
-			} else if (xml[pos] == ' ' || xml[pos] == '\n' || xml[pos] == '\t') { node_value += xml[pos]; ++pos; }
-			else { value_flag = 1; node_value += xml[pos]; ++pos; }
-		}
-		if (value_flag == 1) node->value(node_value); //内容書き込み
-		//子ノード
-		while (1) {
-			err = parse_type(xml, pos, node);
-			if (err < 0) return err;
-			if (err == 1) break;
-			end_tag = xml.find('<', pos);
-			if (end_tag == string::npos) return -1; //error
-			pos = end_tag + 1;
-		}
-		/*----------終了タグ----------*/
-		string end_name;
-		err = parse_name(xml, pos, end_name);
-		if (err < 0) return err;
-		else if (err == 4) return 4; //pi
-		if (end_name != node_name) return -5; //ノード名が違う
-		if (err == 0) {
-			// ">" まで進む
-			while (1) {
-				if (pos >= xml.size()) return -1;
-				if (xml[pos] == '>') { ++pos; break; }
-				if (xml[pos] != ' ' && xml[pos] != '\n' && xml[pos] != '\t') return -6;
-				++pos;
-			}
-		}
-		/*----------終了タグ----------*/
-		return 0;
-	}
-	int parse_comment(const string& xml, size_t& pos, xml_node<T>* parent) { //<!--value-->
-		size_t end_tag = xml.find("-->", pos); // "-->"を検索
-		if (end_tag == string::npos) return -1; //タグの終端が存在しない
-		string val = xml.substr(pos, end_tag-pos); //内容を切り取り
-		parent->add_end_child("", val, comment); //コメントタグを追加
-		pos = end_tag + 3;
-		return 0;
-	}
-	int parse_doctype(const string& xml, size_t& pos, xml_node<T>* parent) { //<!DOCTYPE>
-		string val;
-		size_t end_tag;
-		while(pos < xml.size()) {
-			switch (xml[pos]) {
-				case '>':
-					//終了
-					parent->add_end_child("", val, doctype); //DOCTYPEタグを追加
-					++pos;
-					return 0;
-				case '[':
-					++pos;
-					end_tag = xml.find("]", pos); // ']' を検索
-					if (end_tag == string::npos) return -1; // ']' が存在しない
-					val += "[" + xml.substr(pos, end_tag-pos) + "]";
-					pos = end_tag + 1;
-					break;
-				case '<': case ']': case ';': case ':': case ',': case '&':
-					//禁止文字
-					return -2;
-				default:
-					val += xml[pos];
-					++pos;
-					break;
-			}
-		}
-		return -1;
-	}
-	int parse_pi(const string& xml, size_t& pos, xml_node<T>* parent) { //<?value?>
-		size_t end_tag = xml.find("?>", pos); // "?>"を検索
-		if (end_tag == string::npos) return -1; //タグの終端が存在しない
-		string val = xml.substr(pos, end_tag-pos); //内容を切り取り
-		parent->add_end_child("", val, pi); //PIタグを追加
-		pos = end_tag + 2;
-		return 0;
-	}
-
-	//書き出し処理
-	string print_value_out(const string& val) { //特殊文字の変換
-		string out;
-		size_t pos = 0;
-		while (pos < val.size()) {
-			switch (val[pos]) {
-				case '<':  out += "&lt;";   break;
-				case '>':  out += "&gt;";   break;
-				case '&':  out += "&amp;";  break;
-				case '\"': out += "&quot;"; break;
-				case '\'': out += "&apos;"; break;
-				default:   out += val[pos]; break;
-			}
-			++pos;
-		}
-		return out;
-	}
-	void print_attribute(string& xml, xml_node<T>* node) {
-		xml_attribute<T>* attr = nullptr;
-		for (auto it : node->a_list) {
-			attr = it.second;
-			if (attr->name().empty() == false) xml += " " + attr->name() + "=\"" + print_value_out(attr->value()) + "\"";
-		}
-	}
-	void print_child(string& xml, xml_node<T>* node, int indent, const string& indenttext, const string& new_line) {
-		xml_node<T>* child = node->first_child();
-		size_t next_indent;
-		if (indent >= 0) {
-			if (node->n_type == document) next_indent = indent;
-			else next_indent = indent + 1;
-		} else next_indent = -1;
-
-		while (child != nullptr) {
-			switch (child->type()) {
-				case doctype: print_doctype(xml, child, next_indent, indenttext, new_line); break;
-				case comment: print_comment(xml, child, next_indent, indenttext, new_line); break;
-				case normal:  print_normal(xml, child, next_indent, indenttext, new_line);  break;
-				case pi:      print_pi(xml, child, next_indent, indenttext, new_line);      break;
-				default: break;
-			}
-			child = child->next_node();
-		}
-	}
-	void print_doctype(string& xml, xml_node<T>* node, int indent, const string& indenttext, const string& new_line) {
-		for (int i = 0; i < indent; i++) xml += indenttext; //インデント
-		xml += "<!DOCTYPE " + node->value() + ">" + new_line;
-	}
-	void print_normal(string& xml, xml_node<T>* node, int indent, const string& indenttext, const string& new_line) {
-		for (int i = 0; i < indent; i++) xml += indenttext; //インデント
-		xml += "<" + node->name(); //開始タグ
-		print_attribute(xml, node);
-		if (node->value().empty() == false || node->first_child() != nullptr) {
-			xml += ">" + print_value_out(node->value());
-			if (node->n_first != nullptr) {
-				xml += new_line;
-				print_child(xml, node, indent, indenttext, new_line);
-				for (int i = 0; i < indent; i++) xml += indenttext; //インデント
-			}
-			xml += "</" + node->name() + ">" + new_line; //終了タグ
-		} else xml += "/>" + new_line;
-	}
-	void print_comment(string& xml, xml_node<T>* node, int indent, const string& indenttext, const string& new_line) {
-		for (int i = 0; i < indent; i++) xml += indenttext; //インデント
-		xml += "<!--" + node->value() + "-->" + new_line;
-	}
-	void print_pi(string& xml, xml_node<T>* node, int indent, const string& indenttext, const string& new_line) {
-		for (int i = 0; i < indent; i++) xml += indenttext; //インデント
-		xml += "<?" + node->value() + "?>" + new_line;
-	}
-public:
-	xml_document() { doc.type(document); }
-	xml_document(const string& text) { doc.type(document); parse(text); }
-	~xml_document() { clear(); }
-
-	void clear() { doc.clear(); } //データの解放
-
-	xml_node<T>* get() { return &doc; }
-
-	int parse(const string& text) { //XMLの読み込み
-		clear(); //以前のデータを開放
-
-		size_t pos = text.find('<'); //最初のタグを検索
-		while (pos != string::npos) {
-			++pos;
-			//処理
-			int err = parse_type(text, pos, &doc);
-			if (err < 0) return err; //失敗
-			pos = text.find('<', pos);
-		}
-		return 0;
-	}
-	string print(bool indent = true, const string& indenttext = "\t") { //XMLの書き出し
-		string out;
-		print_child(out, &doc, indent ? 0 : -1, indenttext, indent ? "\n" : "");
-		return out;
-	}
-};
-
-#endif //_MYXML_HPP
+/*! xml.hpp v0.1 | CC0 1.0 (https://creativecommons.org/publicdomain/zero/1.0/deed) */
+
+#ifndef _XML_HPP
+#define _XML_HPP
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <chrono>
+#if !defined(XML_NO_SIMD) && defined(__SSE2__)
+#define XML_USE_SSE2
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define XML_USE_AVX2
+#include <immintrin.h>
+#endif
+#endif
+#if !defined(XML_NO_THREAD)
+#define XML_USE_THREAD
+#include <thread>
+#include <atomic>
+#include <exception>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define XML_USE_POSIX
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+using namespace std;
+
+template <typename T> class xml_node;
+template <typename T> class xml_attribute;
+template <typename T> class xml_attribute_list;
+template <typename T> class xml_document;
+template <typename T> class xml_push_parser;
+template <typename T> class xml_object;
+template <typename T> class xml_atom_table;
+template <typename T> class xml_child_index;
+template <typename T> class xml_query;
+template <typename T> class xml_snapshot;
+template <typename T> class xml_node_view;
+template <typename T> class xml_attribute_view;
+
+//文字列 (Tはchar・char16_t・char32_t UTF-8・UTF-16・UTF-32の文書をそのまま扱う)
+template <typename T> using xml_string = basic_string<T>;
+
+enum xml_obj_type {
+	none,
+	attribute,
+	node
+};
+
+enum xml_node_type {
+	document, //名前なし 属性なし 子ノードあり xmlドキュメントのトップ
+	doctype,  //名前なし 属性なし 子ノードなし 
+	comment,  //名前なし 属性なし 子ノードなし 
+	normal,   //名前あり 属性あり 子ノードあり 通常のノード
+	pi        //名前なし 属性なし 子ノードなし 
+};
+
+//読み込みの指定 (parse関数などのテンプレート引数に組み合わせて指定し、使わない処理をコンパイル時に取り除く)
+enum xml_parse_flag {
+	parse_default  = 0,
+	parse_no_comment = 1,  //コメントを読み飛ばす (ノードを作らない)
+	parse_no_pi      = 2,  //PIを読み飛ばす
+	parse_no_doctype = 4,  //DOCTYPEを読み飛ばす
+	parse_no_escape  = 8,  //特殊文字を変換せず、書かれたまま内容・属性値にする ('&'を特別扱いしない)
+	parse_trim       = 16, //内容の前後の空白を取り除く (空白のみの内容は空になる)
+	parse_no_cdata   = 32  //CDATAを読み飛ばす (前後の内容のみを結合する)
+};
+
+//文字の検索 (charの場合はSSE2・AVX2が有効ならベクトル命令で16/32byteずつ検索、XML_NO_SIMDで無効化)
+struct xml_scan {
+	template <typename C>
+	static bool is_space(C c) { return c == ' ' || c == '\t' || c == '\n'; }
+	template <typename C>
+	static bool is_name_end(C c) { //名前の終端文字
+		switch (c) {
+			case ' ': case '\t': case '\n': case '=': case '>': case '/': case '?':
+			case ';': case ':': case ',': case '&':
+				return true;
+			default: return false;
+		}
+	}
+
+	//ASCIIの文字列textとlen文字を比較 (string::compareと同じ符号)
+	template <typename C>
+	static int compare(const C* p, const char* text, size_t len) {
+		for (size_t i = 0; i < len; i++) {
+			C c = (C)(unsigned char)text[i];
+			if (p[i] != c) return (typename make_unsigned<C>::type)p[i] < (typename make_unsigned<C>::type)c ? -1 : 1;
+		}
+		return 0;
+	}
+	static int compare(const char* p, const char* text, size_t len) { return char_traits<char>::compare(p, text, len); }
+
+	//aまたはbの位置 (見つからない場合はend)
+	template <typename C>
+	static const C* find(const C* p, const C* end, char a, char b) {
+		while (p < end && *p != (C)a && *p != (C)b) ++p;
+		return p;
+	}
+	static const char* find(const char* p, const char* end, char a, char b) {
+#ifdef XML_USE_AVX2
+		const __m256i wa = _mm256_set1_epi8(a), wb = _mm256_set1_epi8(b);
+		while (end - p >= 32) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)p);
+			unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, wa), _mm256_cmpeq_epi8(v, wb)));
+			if (mask != 0) return p + __builtin_ctz(mask);
+			p += 32;
+		}
+#endif
+#ifdef XML_USE_SSE2
+		const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+		while (end - p >= 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)p);
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+			if (mask != 0) return p + __builtin_ctz(mask);
+			p += 16;
+		}
+#endif
+		return find<char>(p, end, a, b);
+	}
+	//名前の終端文字の位置 (見つからない場合はend)
+	template <typename C>
+	static const C* find_name_end(const C* p, const C* end) {
+		while (p < end && !is_name_end(*p)) ++p;
+		return p;
+	}
+	static const char* find_name_end(const char* p, const char* end) {
+#ifdef XML_USE_SSE2
+		const __m128i c1 = _mm_set1_epi8(' '), c2 = _mm_set1_epi8('\t'), c3 = _mm_set1_epi8('\n'), c4 = _mm_set1_epi8('=');
+		const __m128i c5 = _mm_set1_epi8('>'), c6 = _mm_set1_epi8('/'), c7 = _mm_set1_epi8('?'), c8 = _mm_set1_epi8(';');
+		const __m128i c9 = _mm_set1_epi8(':'), c10 = _mm_set1_epi8(','), c11 = _mm_set1_epi8('&');
+		while (end - p >= 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)p);
+			__m128i m = _mm_or_si128(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, c1), _mm_cmpeq_epi8(v, c2)), _mm_or_si128(_mm_cmpeq_epi8(v, c3), _mm_cmpeq_epi8(v, c4))),
+			                         _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, c5), _mm_cmpeq_epi8(v, c6)), _mm_or_si128(_mm_cmpeq_epi8(v, c7), _mm_cmpeq_epi8(v, c8))));
+			m = _mm_or_si128(m, _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, c9), _mm_cmpeq_epi8(v, c10)), _mm_cmpeq_epi8(v, c11)));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(m);
+			if (mask != 0) return p + __builtin_ctz(mask);
+			p += 16;
+		}
+#endif
+		return find_name_end<char>(p, end);
+	}
+	//書き出し時に変換が必要な文字 (< > & " ') の位置 (見つからない場合はend)
+	template <typename C>
+	static const C* find_escape(const C* p, const C* end) {
+		while (p < end && *p != '<' && *p != '>' && *p != '&' && *p != '\"' && *p != '\'') ++p;
+		return p;
+	}
+	static const char* find_escape(const char* p, const char* end) {
+#ifdef XML_USE_AVX2
+		const __m256i w1 = _mm256_set1_epi8('<'), w2 = _mm256_set1_epi8('>'), w3 = _mm256_set1_epi8('&'), w4 = _mm256_set1_epi8('\"'), w5 = _mm256_set1_epi8('\'');
+		while (end - p >= 32) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)p);
+			__m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, w1), _mm256_cmpeq_epi8(v, w2)), _mm256_or_si256(_mm256_cmpeq_epi8(v, w3), _mm256_cmpeq_epi8(v, w4)));
+			unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(m, _mm256_cmpeq_epi8(v, w5)));
+			if (mask != 0) return p + __builtin_ctz(mask);
+			p += 32;
+		}
+#endif
+#ifdef XML_USE_SSE2
+		const __m128i c1 = _mm_set1_epi8('<'), c2 = _mm_set1_epi8('>'), c3 = _mm_set1_epi8('&'), c4 = _mm_set1_epi8('\"'), c5 = _mm_set1_epi8('\'');
+		while (end - p >= 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)p);
+			__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, c1), _mm_cmpeq_epi8(v, c2)), _mm_or_si128(_mm_cmpeq_epi8(v, c3), _mm_cmpeq_epi8(v, c4)));
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(m, _mm_cmpeq_epi8(v, c5)));
+			if (mask != 0) return p + __builtin_ctz(mask);
+			p += 16;
+		}
+#endif
+		return find_escape<char>(p, end);
+	}
+	//空白文字以外が含まれるか
+	template <typename C>
+	static bool has_text(const C* p, const C* end) {
+		while (p < end) {
+			if (!is_space(*p)) return true;
+			++p;
+		}
+		return false;
+	}
+};
+
+//メモリプール xml_documentが所有するノード・属性の確保先
+class xml_memory_pool {
+	struct free_item { free_item* next; };
+	static const size_t block_size = 64 * 1024; //ブロックの大きさ
+	static const size_t unit = 16;              //確保単位 (ヘッダーの大きさ・アライメント)
+	static const size_t class_num = 32;         //フリーリストで管理するサイズの種類 (unit * class_num byteまで)
+
+	char* p_block; //確保済みブロック (先頭に前のブロックへのポインタを格納)
+	char* p_pos;   //未使用領域の先頭
+	char* p_end;   //未使用領域の終端
+	free_item* p_free[class_num]; //サイズごとの解放済み領域
+
+	static size_t round_size(size_t size) { return (size + unit + unit - 1) / unit * unit; } //ヘッダー込みの大きさ
+
+	void* allocate(size_t size) {
+		size_t index = size / unit - 1;
+		if (p_free[index] != nullptr) {
+			//解放済み領域を再利用
+			free_item* item = p_free[index];
+			p_free[index] = item->next;
+			return item;
+		}
+		if (p_pos == nullptr || (size_t)(p_end - p_pos) < size) {
+			//新しいブロックを確保
+			char* block = (char*)malloc(block_size);
+			if (block == nullptr) throw bad_alloc();
+			*(char**)block = p_block;
+			p_block = block;
+			p_pos = block + unit;
+			p_end = block + block_size;
+		}
+		void* out = p_pos;
+		p_pos += size;
+		return out;
+	}
+	void deallocate(void* p, size_t size) {
+		free_item* item = (free_item*)p;
+		item->next = p_free[size / unit - 1];
+		p_free[size / unit - 1] = item;
+	}
+public:
+	xml_memory_pool() {
+		p_block = nullptr; p_pos = nullptr; p_end = nullptr;
+		for (size_t i = 0; i < class_num; i++) p_free[i] = nullptr;
+	}
+	xml_memory_pool(const xml_memory_pool&) = delete;
+	xml_memory_pool& operator=(const xml_memory_pool&) = delete;
+	~xml_memory_pool() { release(); }
+
+	void release() { //すべてのブロックを一括で解放
+		while (p_block != nullptr) {
+			char* prev = *(char**)p_block;
+			free(p_block);
+			p_block = prev;
+		}
+		p_pos = nullptr; p_end = nullptr;
+		for (size_t i = 0; i < class_num; i++) p_free[i] = nullptr;
+	}
+
+	//ヘッダー付きで確保 (poolがnullptrか大きすぎる場合はヒープから確保)
+	static void* object_new(size_t size, xml_memory_pool* pool) {
+		size_t total = round_size(size);
+		char* p;
+		if (pool != nullptr && total <= unit * class_num) p = (char*)pool->allocate(total);
+		else {
+			p = (char*)malloc(total);
+			if (p == nullptr) throw bad_alloc();
+			pool = nullptr;
+		}
+		*(xml_memory_pool**)p = pool; //確保元を記録
+		return p + unit;
+	}
+	//object_newで確保した領域を解放 (size = 0 の場合プールには戻さない)
+	static void object_delete(void* obj, size_t size) {
+		if (obj == nullptr) return;
+		xml_memory_pool* pool = owner(obj);
+		if (pool == nullptr) free((char*)obj - unit);
+		else if (size != 0) pool->deallocate((char*)obj - unit, round_size(size));
+	}
+	static xml_memory_pool* owner(const void* obj) { return *(xml_memory_pool* const*)((const char*)obj - unit); } //確保元のプール
+
+	size_t blocks() const { //確保済みのブロックの数
+		size_t count = 0;
+		for (char* block = p_block; block != nullptr; block = *(char**)block) ++count;
+		return count;
+	}
+	size_t reserved() const { return blocks() * block_size; } //確保済みのbyte数
+};
+
+//特殊文字の変換 (&lt; &gt; &amp; &quot; &#N; &#xN; をメモリを確保せずに変換)
+struct xml_entity {
+	static const size_t max_units = 4; //1つの特殊文字を変換した最大の文字数
+
+	template <typename C>
+	static bool match(const C* p, const C* end, const char* text, size_t len) {
+		return (size_t)(end - p) >= len && xml_scan::compare(p, text, len) == 0;
+	}
+	static int encode(unsigned int utf32, char* out) { //UTF-8に変換して書き込んだbyte数 (範囲外は0)
+		if (utf32 <= 0x007F) { //1byte
+			out[0] = (char)utf32;
+			return 1;
+		} else if (utf32 <= 0x07FF) { //2byte
+			out[0] = (char)(0xC0 | ((utf32 & 0x7C0) >> 6));
+			out[1] = (char)(0x80 |  (utf32 & 0x3F));
+			return 2;
+		} else if (utf32 <= 0xFFFF) { //3byte
+			out[0] = (char)(0xE0 | ((utf32 & 0xF000) >> 12));
+			out[1] = (char)(0x80 | ((utf32 & 0xFC0) >> 6));
+			out[2] = (char)(0x80 |  (utf32 & 0x3F));
+			return 3;
+		} else if (utf32 <= 0x1FFFFF) { //4byte
+			out[0] = (char)(0xF0 | ((utf32 & 0x1C0000) >> 18));
+			out[1] = (char)(0x80 | ((utf32 & 0x3F000) >> 12));
+			out[2] = (char)(0x80 | ((utf32 & 0xFC0) >> 6));
+			out[3] = (char)(0x80 |  (utf32 & 0x3F));
+			return 4;
+		}
+		return 0;
+	}
+	static int encode(unsigned int utf32, char16_t* out) { //UTF-16に変換して書き込んだ数 (範囲外は0)
+		if (utf32 <= 0xFFFF) {
+			out[0] = (char16_t)utf32;
+			return 1;
+		} else if (utf32 <= 0x10FFFF) { //サロゲートペア
+			out[0] = (char16_t)(0xD800 | ((utf32 - 0x10000) >> 10));
+			out[1] = (char16_t)(0xDC00 | ((utf32 - 0x10000) & 0x3FF));
+			return 2;
+		}
+		return 0;
+	}
+	static int encode(unsigned int utf32, char32_t* out) { //UTF-32 (範囲外は0)
+		if (utf32 <= 0x1FFFFF) {
+			out[0] = (char32_t)utf32;
+			return 1;
+		}
+		return 0;
+	}
+	//pの'&'から1つの特殊文字を変換してout(max_units文字)に書き込み、書き込んだ文字数を返す (pは';'の次に進む -1 = 書式の誤り -3 = 未対応の名前)
+	template <typename C>
+	static int decode(const C*& p, const C* end, C* out) {
+		if      (match(p+1, end, "lt;", 3))   { out[0] = '<';  p += 4; return 1; } //&lt; <
+		else if (match(p+1, end, "gt;", 3))   { out[0] = '>';  p += 4; return 1; } //&gt; >
+		else if (match(p+1, end, "amp;", 4))  { out[0] = '&';  p += 5; return 1; } //&amp; &
+		else if (match(p+1, end, "quot;", 5)) { out[0] = '\"'; p += 6; return 1; } //&quot; "
+		else if (match(p+1, end, "apos;", 5)) { out[0] = '\''; p += 6; return 1; } //&apos; '
+		else if (match(p+1, end, "#", 1)) { //Unicode &#N~N; (10進数表記) &#xN~N; (16進数表記)
+			const C* q = p + 2;
+			unsigned int base = 10;
+			if (match(q, end, "x", 1)) { base = 16; ++q; }
+			const C* digit = q;
+			unsigned int utf32 = 0;
+			while (1) {
+				if (q >= end) return -1;
+				unsigned int n;
+				if (*q >= '0' && *q <= '9') n = *q - '0';
+				else if (base == 16 && *q >= 'a' && *q <= 'f') n = *q - 'a' + 10;
+				else if (base == 16 && *q >= 'A' && *q <= 'F') n = *q - 'A' + 10;
+				else if (*q == ';') break;
+				else return -1;
+				if (utf32 <= 0x1FFFFF) utf32 = utf32 * base + n; //範囲外になった値はそれ以上計算しない
+				++q;
+			}
+			if (q == digit) return -1; //数字がない
+			p = q + 1;
+			return encode(utf32, out);
+		}
+		return -3;
+	}
+	//特殊文字を含む範囲を変換してoutに追加 (読み込み時に書式を確認済みの範囲に使用)
+	template <typename C>
+	static void decode_append(xml_string<C>& out, const C* p, size_t len) {
+		const C* end = p + len;
+		while (p < end) {
+			const C* stop = char_traits<C>::find(p, end - p, (C)'&');
+			if (stop == nullptr) stop = end;
+			out.append(p, stop - p);
+			if (stop == end) break;
+			p = stop;
+			C buf[max_units];
+			int n = decode(p, end, buf);
+			if (n < 0) { out += (C)'&'; ++p; } //変換できない場合はそのまま
+			else out.append(buf, n);
+		}
+	}
+};
+
+//文字列 (自身で所有する文字列、または読み込み元バッファの一部を参照)
+template <typename T = char>
+class xml_text {
+	xml_string<T> t_str;      //所有する文字列
+	const T* t_ptr;    //参照先 (nullptrの場合はt_strを使用)
+	size_t t_len;      //参照する長さ
+	bool t_raw;        //特殊文字が未変換 (decodeで変換する)
+public:
+	xml_text() { t_ptr = nullptr; t_len = 0; t_raw = false; }
+	xml_text(const xml_string<T>& text) : t_str(text) { t_ptr = nullptr; t_len = 0; t_raw = false; }
+	xml_text(xml_string<T>&& text) : t_str(std::move(text)) { t_ptr = nullptr; t_len = 0; t_raw = false; }
+	xml_text& operator=(const xml_string<T>& text) { t_str = text; t_ptr = nullptr; t_len = 0; t_raw = false; return *this; }
+	xml_text& operator=(xml_string<T>&& text) { t_str = std::move(text); t_ptr = nullptr; t_len = 0; t_raw = false; return *this; } //確保済みの領域を引き継ぐ
+	void assign(const T* p, size_t len) { t_str.assign(p, len); t_ptr = nullptr; t_len = 0; t_raw = false; } //コピーして所有
+
+	void refer(const T* p, size_t len) { t_str.clear(); t_ptr = p; t_len = len; t_raw = false; } //バッファの一部を参照
+	void own() { if (t_ptr != nullptr) { t_str.assign(t_ptr, t_len); t_ptr = nullptr; t_len = 0; } } //所有する文字列に変換
+	void append(const xml_string<T>& text) { decode(); own(); t_str += text; }
+	void append(xml_string<T>&& text) { //空なら確保済みの領域を引き継ぐ
+		decode();
+		if (empty()) *this = std::move(text);
+		else { own(); t_str += text; }
+	}
+	bool is_ref() const { return t_ptr != nullptr; }
+	size_t capacity() const { return t_ptr != nullptr ? 0 : t_str.capacity(); } //所有する文字列の確保済みの大きさ (参照中は0)
+
+	void raw() { t_raw = true; } //内容を特殊文字が未変換の状態として扱う
+	bool is_raw() const { return t_raw; }
+	void decode() { //未変換の特殊文字を変換 (変換後の内容を所有する)
+		if (!t_raw) return;
+		xml_string<T> out;
+		out.reserve(size());
+		xml_entity::decode_append(out, data(), size());
+		t_str.swap(out); t_ptr = nullptr; t_len = 0; t_raw = false;
+	}
+
+	const T* data() const { return t_ptr != nullptr ? t_ptr : t_str.data(); }
+	size_t size() const { return t_ptr != nullptr ? t_len : t_str.size(); }
+	bool empty() const { return size() == 0; }
+	xml_string<T> str() const { return t_ptr != nullptr ? xml_string<T>(t_ptr, t_len) : t_str; }
+	bool operator==(const xml_string<T>& text) const { return text.compare(0, string::npos, data(), size()) == 0; }
+	bool operator!=(const xml_string<T>& text) const { return !(*this == text); }
+};
+
+//読み込み元 (文字列・メモリマップしたファイルなどの範囲を参照、範囲外は'\0'として扱う)
+template <typename T = char>
+class xml_source {
+	const T* s_data;
+	size_t s_size;
+public:
+	xml_source(const T* data, size_t size) { s_data = data; s_size = size; }
+	xml_source(const xml_string<T>& text) { s_data = text.data(); s_size = text.size(); }
+
+	const T* data() const { return s_data; }
+	size_t size() const { return s_size; }
+	T operator[](size_t pos) const { return pos < s_size ? s_data[pos] : T(); }
+	xml_string<T> substr(size_t pos, size_t len) const { return xml_string<T>(s_data + pos, len); }
+
+	//string::compareと同じ比較
+	int compare(size_t pos, size_t len, const char* text) const { //ASCIIの文字列との比較
+		size_t text_len = char_traits<char>::length(text);
+		if (pos > s_size) pos = s_size;
+		if (len > s_size - pos) len = s_size - pos;
+		int out = xml_scan::compare(s_data + pos, text, len < text_len ? len : text_len);
+		if (out != 0) return out;
+		return len < text_len ? -1 : (len > text_len ? 1 : 0);
+	}
+	int compare(size_t pos, size_t len, const xml_source<T>& text, size_t text_pos, size_t text_len) const {
+		return compare(pos, len, text.s_data + text_pos, text_len);
+	}
+	int compare(size_t pos, size_t len, const T* text, size_t text_len) const {
+		if (pos > s_size) pos = s_size;
+		if (len > s_size - pos) len = s_size - pos;
+		int out = char_traits<T>::compare(s_data + pos, text, len < text_len ? len : text_len);
+		if (out != 0) return out;
+		return len < text_len ? -1 : (len > text_len ? 1 : 0);
+	}
+	//string::findと同じ検索
+	size_t find(char c, size_t pos = 0) const {
+		if (pos >= s_size) return string::npos;
+		const T* out = char_traits<T>::find(s_data + pos, s_size - pos, (T)c);
+		return out != nullptr ? out - s_data : string::npos;
+	}
+	size_t find(const char* text, size_t pos = 0) const { //ASCIIの文字列の検索
+		size_t len = char_traits<char>::length(text);
+		while (pos + len <= s_size) {
+			pos = find(text[0], pos);
+			if (pos == string::npos || pos + len > s_size) break;
+			if (xml_scan::compare(s_data + pos, text, len) == 0) return pos;
+			++pos;
+		}
+		return string::npos;
+	}
+};
+
+//文字列への書き出し
+template <typename T = char>
+class xml_string_writer {
+	xml_string<T>& w_out;
+public:
+	xml_string_writer(xml_string<T>& out) : w_out(out) {}
+	void write(const T* p, size_t len) { w_out.append(p, len); }
+	void write(T c) { w_out += c; }
+};
+
+//確保済みの領域への書き出し (大きさを計算した範囲を分担して書き出す)
+template <typename T = char>
+class xml_span_writer {
+	T* w_pos;
+public:
+	xml_span_writer(T* p) { w_pos = p; }
+	void write(const T* p, size_t len) { char_traits<T>::copy(w_pos, p, len); w_pos += len; }
+	void write(T c) { *w_pos++ = c; }
+};
+
+//書き出す大きさの計算 (文字数)
+template <typename T = char>
+class xml_size_counter {
+	size_t w_size;
+public:
+	xml_size_counter() { w_size = 0; }
+	void write(const T*, size_t len) { w_size += len; }
+	void write(T) { ++w_size; }
+	size_t size() const { return w_size; }
+};
+
+//ストリーム・ファイル・コールバックへの書き出し (固定長のバッファに溜めて、一杯になったら出力する)
+//出力先にはTの配列をそのままのバイト列で渡す (char16_t・char32_tは実行環境のバイト順)
+template <typename T = char>
+class xml_writer {
+	static const size_t buffer_size = 64 * 1024; //文字数
+	T* w_buf;
+	size_t w_size; //バッファ内の文字数
+	function<bool(const char*, size_t)> w_sink; //出力先 (false = 失敗)
+	bool w_fail;   //出力に失敗した
+
+	bool sink(const T* p, size_t len) { return w_sink((const char*)p, len * sizeof(T)); }
+public:
+	xml_writer(const function<bool(const char*, size_t)>& sink) : w_sink(sink) { w_buf = new T[buffer_size]; w_size = 0; w_fail = false; }
+	xml_writer(const xml_writer&) = delete;
+	xml_writer& operator=(const xml_writer&) = delete;
+	~xml_writer() { delete[] w_buf; }
+
+	void write(const T* p, size_t len) {
+		if (w_size + len > buffer_size) {
+			flush();
+			if (len >= buffer_size) { //バッファより大きい場合は直接出力
+				if (!w_fail && !sink(p, len)) w_fail = true;
+				return;
+			}
+		}
+		char_traits<T>::copy(w_buf + w_size, p, len);
+		w_size += len;
+	}
+	void write(T c) {
+		if (w_size == buffer_size) flush();
+		w_buf[w_size++] = c;
+	}
+	bool flush() { //バッファの内容を出力 (false = 失敗)
+		if (w_size != 0 && !w_fail && !sink(w_buf, w_size)) w_fail = true;
+		w_size = 0;
+		return !w_fail;
+	}
+};
+
+//共有する名前 (xml_atom_tableで作成し、同じ表の名前はポインタで比較できる)
+template <typename T = char>
+class xml_atom {
+	xml_string<T> a_name;
+	size_t a_hash;
+	const xml_atom_table<T>* a_table; //作成した表
+	xml_atom<T>* a_next;              //同じバケットの次の名前
+	const xml_atom<T>* a_alias;       //統合先の表の同じ名前 (xml_atom_table::merge)
+
+	friend class xml_atom_table<T>;
+	friend class xml_object<T>;
+public:
+	const xml_string<T>& name() const { return a_name; }
+	const xml_atom_table<T>* table() const { return a_table; }
+};
+
+//名前の表 (ドキュメントごとに同じ名前を1つの文字列で共有する)
+template <typename T = char>
+class xml_atom_table {
+	vector<xml_atom<T>*> t_bucket; //バケット (2のべき乗)
+	size_t t_size;
+
+	static size_t hash(const T* p, size_t len) { //FNV-1a (1文字ずつ)
+		size_t h = (size_t)14695981039346656037ull;
+		for (size_t i = 0; i < len; i++) h = (h ^ (typename make_unsigned<T>::type)p[i]) * (size_t)1099511628211ull;
+		return h;
+	}
+	xml_atom<T>* find(const T* p, size_t len, size_t h) const {
+		if (t_bucket.empty()) return nullptr;
+		for (xml_atom<T>* atom = t_bucket[h & (t_bucket.size() - 1)]; atom != nullptr; atom = atom->a_next) {
+			if (atom->a_hash == h && atom->a_name.compare(0, string::npos, p, len) == 0) return atom;
+		}
+		return nullptr;
+	}
+	void rehash(size_t size) {
+		vector<xml_atom<T>*> bucket(size, nullptr);
+		for (xml_atom<T>* atom : t_bucket) {
+			while (atom != nullptr) {
+				xml_atom<T>* next = atom->a_next;
+				atom->a_next = bucket[atom->a_hash & (size - 1)];
+				bucket[atom->a_hash & (size - 1)] = atom;
+				atom = next;
+			}
+		}
+		t_bucket.swap(bucket);
+	}
+public:
+	xml_atom_table() { t_size = 0; }
+	xml_atom_table(const xml_atom_table&) = delete;
+	xml_atom_table& operator=(const xml_atom_table&) = delete;
+	~xml_atom_table() { clear(); }
+
+	void clear() { //すべての名前を破棄 (参照しているノードがないこと)
+		for (xml_atom<T>* atom : t_bucket) {
+			while (atom != nullptr) {
+				xml_atom<T>* next = atom->a_next;
+				delete atom;
+				atom = next;
+			}
+		}
+		t_bucket.clear();
+		t_size = 0;
+	}
+	size_t size() const { return t_size; }
+	const xml_atom<T>* find(const xml_string<T>& name) const { return find(name.data(), name.size(), hash(name.data(), name.size())); } //登録済みの名前 (なければnullptr)
+	const xml_atom<T>* intern(const T* p, size_t len) { //名前を登録して取得
+		size_t h = hash(p, len);
+		xml_atom<T>* atom = find(p, len, h);
+		if (atom != nullptr) return atom;
+		if (t_size >= t_bucket.size()) rehash(t_bucket.empty() ? 64 : t_bucket.size() * 2);
+		atom = new xml_atom<T>();
+		atom->a_name.assign(p, len);
+		atom->a_hash = h;
+		atom->a_table = this;
+		atom->a_alias = nullptr;
+		atom->a_next = t_bucket[h & (t_bucket.size() - 1)];
+		t_bucket[h & (t_bucket.size() - 1)] = atom;
+		++t_size;
+		return atom;
+	}
+	const xml_atom<T>* intern(const xml_string<T>& name) { return intern(name.data(), name.size()); }
+	void merge(xml_atom_table<T>& from) { //fromの名前をすべて登録し、fromの各名前に統合先を記録
+		for (xml_atom<T>* atom : from.t_bucket) {
+			for (; atom != nullptr; atom = atom->a_next) atom->a_alias = intern(atom->a_name);
+		}
+	}
+};
+
+template <typename T = char>
+class xml_object {
+protected:
+	xml_text<T> o_name;
+	xml_text<T> o_value;
+	const xml_atom<T>* o_atom; //共有している名前 (nullptr = 名前を個別に所有)
+	xml_node<T>* n_parent;
+
+	void set_name(const T* p, size_t len, xml_atom_table<T>* atoms) { //名前を設定 (atomsがあれば共有の名前を参照する)
+		if (atoms != nullptr && len != 0) {
+			o_atom = atoms->intern(p, len);
+			o_name.refer(o_atom->a_name.data(), len);
+		} else {
+			o_atom = nullptr;
+			o_name = xml_string<T>(p, len);
+		}
+	}
+	void set_atom(const xml_atom<T>* atom) { //名前の表の名前を設定
+		o_atom = atom;
+		o_name.refer(atom->a_name.data(), atom->a_name.size());
+	}
+	void merge_name() { if (o_atom != nullptr) set_atom(o_atom->a_alias); } //名前を統合先の表の名前に置き換える (xml_atom_table::merge後)
+	bool match(const xml_atom<T>* atom) const { //名前の比較 (同じ表の名前はポインタで比較)
+		if (o_atom == atom) return true;
+		if (o_atom != nullptr && o_atom->a_table == atom->a_table) return false;
+		return o_name == atom->a_name;
+	}
+public:
+	xml_object() { o_atom = nullptr; }
+	virtual ~xml_object() {}
+
+	//メモリ確保 (確保元のプールをヘッダーに記録し、deleteでそこへ戻す)
+	static void* operator new(size_t size) { return xml_memory_pool::object_new(size, nullptr); }
+	static void* operator new(size_t size, xml_memory_pool* pool) { return xml_memory_pool::object_new(size, pool); }
+	static void operator delete(void* p, size_t size) { xml_memory_pool::object_delete(p, size); }
+	static void operator delete(void* p, xml_memory_pool*) { xml_memory_pool::object_delete(p, 0); }
+
+	virtual xml_obj_type obj_type() { return none; }
+	xml_node<T>* parent() { return n_parent; }
+	//取得は仮想関数を使わない (xml_node・xml_attributeで共通)
+	xml_string<T> name() const { return o_name.str(); }
+	const xml_text<T>& name_text() const { return o_name; } //コピーせずに参照 (data()・size()で取得)
+	virtual void name(const xml_string<T>& text) { o_name = text; o_atom = nullptr; }
+	const xml_atom<T>* atom() { return o_atom; } //共有している名前 (nullptr = 名前を個別に所有)
+	xml_string<T> value() { o_value.decode(); return o_value.str(); } //未変換の特殊文字は最初の取得時に変換
+	const xml_text<T>& value_text() { o_value.decode(); return o_value; } //コピーせずに参照 (編集・削除まで有効)
+	virtual void value(xml_string<T> text) { o_value = std::move(text); } //右辺値は領域を引き継ぐ
+};
+
+template <typename T = char>
+class xml_attribute : public xml_object<T> {
+	using xml_object<T>::o_name;
+	using xml_object<T>::o_value;
+	using xml_object<T>::o_atom;
+	using xml_object<T>::n_parent;
+	using xml_object<T>::set_name;
+	using xml_object<T>::set_atom;
+	using xml_object<T>::merge_name;
+	using xml_object<T>::match;
+
+	void remove_same_name() { //親ノードに同名の別の属性が存在する場合それを削除
+		xml_attribute<T>* attr = n_parent->a_list.find(o_name.data(), o_name.size(), this);
+		if (attr != nullptr) {
+			n_parent->a_list.erase(attr);
+			attr->n_parent = nullptr;
+			delete attr;
+		}
+	}
+	void set_parent() { //親ノードの末尾に自分を登録
+		remove_same_name();
+		n_parent->a_list.push_back(this);
+		n_parent->touch();
+	}
+
+	friend class xml_node<T>;
+	friend class xml_attribute_list<T>;
+	friend class xml_document<T>;
+	friend class xml_query<T>;
+public:
+	xml_attribute() { n_parent = nullptr; }
+	xml_attribute(xml_string<T> n, xml_string<T> v) { o_name = std::move(n); o_value = std::move(v); n_parent = nullptr; }
+	xml_attribute(const xml_string<T>& n, xml_string<T> v, xml_node<T>* parent) { //親ノードに自分を登録
+		set_name(n.data(), n.size(), parent->n_atoms);
+		o_value = std::move(v);
+		n_parent = parent;
+		set_parent();
+	}
+	~xml_attribute() { clear_parent(); }
+
+	xml_obj_type obj_type() { return attribute; }
+
+	void clear_parent() {
+		if (n_parent != nullptr) {
+			//親ノードの登録を削除
+			n_parent->touch();
+			n_parent->a_list.erase(this);
+			n_parent = nullptr;
+		}
+	}
+
+	xml_attribute<T>* move(xml_node<T>* node) { //nodeの末尾に移動 (移動後の属性 nullptrは親ノードから切り離す)
+		if (node != nullptr && (n_parent != nullptr ? n_parent->n_pool : xml_memory_pool::owner(this)) != node->n_pool) {
+			//別のドキュメントへの移動は移動先のプールに名前・内容をコピーして作り直す (移動元の読み込み元・プールを参照しない)
+			xml_attribute<T>* attr = new (node->n_pool) xml_attribute<T>();
+			attr->set_name(o_name.data(), o_name.size(), node->n_atoms);
+			attr->o_value.assign(o_value.data(), o_value.size());
+			if (o_value.is_raw()) attr->o_value.raw();
+			attr->n_parent = node;
+			attr->set_parent();
+			delete this;
+			return attr;
+		}
+		clear_parent();
+		if (node != nullptr) {
+			if (o_atom == nullptr || o_atom->table() != node->n_atoms) set_name(o_name.data(), o_name.size(), node->n_atoms); //移動先の表の名前を参照
+			n_parent = node;
+			set_parent();
+		}
+		return this;
+	}
+
+	using xml_object<T>::name;
+	using xml_object<T>::value;
+	void name(const xml_string<T>& text) {
+		if (n_parent == nullptr) set_name(text.data(), text.size(), nullptr);
+		else {
+			//位置を保ったまま名前を変更 (古い名前の位置をハッシュ表から外してから同名の属性を探す)
+			n_parent->a_list.unhash(this);
+			set_name(text.data(), text.size(), n_parent->n_atoms);
+			remove_same_name();
+			n_parent->a_list.rehash_name(this);
+			n_parent->touch();
+		}
+	}
+
+	void value(xml_string<T> text) {
+		o_value = std::move(text);
+		if (n_parent != nullptr) n_parent->touch();
+	}
+};
+
+//属性の一覧 (追加順を保持し、少数の場合は線形探索、多い場合はハッシュ表で検索)
+template <typename T = char>
+class xml_attribute_list {
+	static const uint32_t inline_size = 2;    //ノード内に保持する数
+	static const uint32_t hash_threshold = 8; //ハッシュ表を作成する数
+
+	xml_attribute<T>* l_inline[inline_size];
+	xml_attribute<T>** l_data; //l_inline または確保した配列
+	uint32_t l_size;
+	uint32_t l_cap;
+	xml_attribute<T>** l_hash; //ハッシュ表 (属性 nullptr = 空 削除で前の要素を詰めても位置が変わらない)
+	uint32_t l_hash_cap;       //ハッシュ表の大きさ (2のべき乗)
+
+	static uint32_t hash(const T* p, size_t len) { //FNV-1a (1文字ずつ)
+		uint32_t h = 2166136261u;
+		for (size_t i = 0; i < len; i++) h = (h ^ (uint32_t)(typename make_unsigned<T>::type)p[i]) * 16777619u;
+		return h;
+	}
+	static bool equal(xml_attribute<T>* attr, const T* p, size_t len) {
+		return attr->o_name.size() == len && char_traits<T>::compare(attr->o_name.data(), p, len) == 0;
+	}
+	void hash_insert(xml_attribute<T>* attr) {
+		uint32_t mask = l_hash_cap - 1;
+		uint32_t h = hash(attr->o_name.data(), attr->o_name.size()) & mask;
+		while (l_hash[h] != nullptr) h = (h + 1) & mask; //線形探索
+		l_hash[h] = attr;
+	}
+	void hash_erase(xml_attribute<T>* attr) { //ハッシュ表から外す (後方シフト削除 後ろに続く要素を本来の位置の側へ詰める)
+		uint32_t mask = l_hash_cap - 1;
+		uint32_t hole = hash(attr->o_name.data(), attr->o_name.size()) & mask;
+		while (l_hash[hole] != attr) hole = (hole + 1) & mask;
+		for (uint32_t h = (hole + 1) & mask; l_hash[h] != nullptr; h = (h + 1) & mask) {
+			uint32_t home = hash(l_hash[h]->o_name.data(), l_hash[h]->o_name.size()) & mask;
+			if (((h - home) & mask) >= ((h - hole) & mask)) { //本来の位置が空きの位置以前なら空きに詰める
+				l_hash[hole] = l_hash[h];
+				hole = h;
+			}
+		}
+		l_hash[hole] = nullptr;
+	}
+public:
+	xml_attribute_list() { l_data = l_inline; l_size = 0; l_cap = inline_size; l_hash = nullptr; l_hash_cap = 0; }
+	xml_attribute_list(const xml_attribute_list&) = delete;
+	xml_attribute_list& operator=(const xml_attribute_list&) = delete;
+	~xml_attribute_list() { clear(); }
+
+	uint32_t size() const { return l_size; }
+	bool empty() const { return l_size == 0; }
+	xml_attribute<T>* operator[](size_t index) const { return l_data[index]; }
+	xml_attribute<T>* const* begin() const { return l_data; }
+	xml_attribute<T>* const* end() const { return l_data + l_size; }
+
+	void clear() {
+		if (l_data != l_inline) delete[] l_data;
+		delete[] l_hash;
+		l_data = l_inline; l_size = 0; l_cap = inline_size; l_hash = nullptr; l_hash_cap = 0;
+	}
+	xml_attribute<T>* find(const xml_atom<T>* atom) const { //名前の表の名前で検索
+		if (l_hash != nullptr) return find(atom->name().data(), atom->name().size());
+		for (uint32_t i = 0; i < l_size; i++) if (l_data[i]->match(atom)) return l_data[i];
+		return nullptr;
+	}
+	xml_attribute<T>* find(const T* name, size_t len, const xml_attribute<T>* except = nullptr) const { //exceptは除く (名前を変更した属性と同名の属性の検索)
+		if (l_hash != nullptr) {
+			uint32_t mask = l_hash_cap - 1;
+			for (uint32_t h = hash(name, len) & mask; l_hash[h] != nullptr; h = (h + 1) & mask) {
+				if (l_hash[h] != except && equal(l_hash[h], name, len)) return l_hash[h];
+			}
+			return nullptr;
+		}
+		for (uint32_t i = 0; i < l_size; i++) if (l_data[i] != except && equal(l_data[i], name, len)) return l_data[i];
+		return nullptr;
+	}
+	void push_back(xml_attribute<T>* attr) { //末尾に追加 (同名の属性が存在しないこと)
+		if (l_size == l_cap) {
+			//配列を拡張
+			xml_attribute<T>** data = new xml_attribute<T>*[l_cap * 2];
+			for (uint32_t i = 0; i < l_size; i++) data[i] = l_data[i];
+			if (l_data != l_inline) delete[] l_data;
+			l_data = data;
+			l_cap *= 2;
+		}
+		l_data[l_size++] = attr;
+		if (l_hash != nullptr && l_size * 2 <= l_hash_cap) hash_insert(attr);
+		else if (l_size > hash_threshold) rehash();
+	}
+	void erase(xml_attribute<T>* attr) { //削除 (順序は保持 ハッシュ表は作り直さずに外し、小さくなった場合のみ作り直す)
+		uint32_t i = 0;
+		while (i < l_size && l_data[i] != attr) ++i;
+		if (i == l_size) return;
+		bool shrink = l_hash != nullptr && (l_size - 1 <= hash_threshold || (l_size - 1) * 16 < l_hash_cap);
+		if (l_hash != nullptr && !shrink) hash_erase(attr);
+		for (; i + 1 < l_size; i++) l_data[i] = l_data[i + 1];
+		--l_size;
+		if (shrink) rehash();
+	}
+	void unhash(xml_attribute<T>* attr) { if (l_hash != nullptr) hash_erase(attr); } //名前の変更前にハッシュ表から外す (変更後にrehash_nameで登録し直すこと)
+	void rehash_name(xml_attribute<T>* attr) { //名前を変更したattrをハッシュ表に登録し直す (削除で表を作り直した場合は登録済み)
+		if (l_hash == nullptr) return;
+		uint32_t mask = l_hash_cap - 1;
+		uint32_t h = hash(attr->o_name.data(), attr->o_name.size()) & mask;
+		for (; l_hash[h] != nullptr; h = (h + 1) & mask) if (l_hash[h] == attr) return;
+		l_hash[h] = attr;
+	}
+	void rehash() { //ハッシュ表の再作成 (追加で大きくなった場合・削除で小さくなった場合)
+		delete[] l_hash;
+		l_hash = nullptr;
+		l_hash_cap = 0;
+		if (l_size <= hash_threshold) return;
+		l_hash_cap = 16;
+		while (l_hash_cap < l_size * 4) l_hash_cap *= 2;
+		l_hash = new xml_attribute<T>*[l_hash_cap]();
+		for (uint32_t i = 0; i < l_size; i++) hash_insert(l_data[i]);
+	}
+};
+
+//子ノードの名前の索引 (名前つきの検索で多くの兄弟をたどったときに親ノードに作成する)
+template <typename T = char>
+class xml_child_index {
+	struct entry {
+		vector<xml_node<T>*> nodes; //同名の子ノード (並び順 削除したノードはnullptr)
+		size_t head; //先頭の有効なノードの位置
+	};
+	unordered_map<xml_string<T>, entry> i_map;
+	size_t i_size; //有効なノードの数
+	size_t i_dead; //削除したノードの数
+
+	static const xml_string<T>& key(xml_node<T>* node, xml_string<T>& buf) {
+		if (node->o_atom != nullptr) return node->o_atom->name();
+		buf = node->o_name.str();
+		return buf;
+	}
+	entry* find(const xml_string<T>& name) {
+		typename unordered_map<xml_string<T>, entry>::iterator it = i_map.find(name);
+		return (it != i_map.end()) ? &it->second : nullptr;
+	}
+public:
+	static const size_t threshold = 32; //この数の兄弟をたどっても見つからない検索で索引を作成
+
+	explicit xml_child_index(xml_node<T>* parent) {
+		i_size = 0;
+		i_dead = 0;
+		for (xml_node<T>* node = parent->n_first; node != nullptr; node = node->n_next) push_back(node);
+	}
+	bool stale() const { return i_dead > threshold && i_dead > i_size; } //削除したノードが多く、作り直しが必要
+	void push_back(xml_node<T>* node) { //末尾に追加したノードを登録
+		xml_string<T> buf;
+		entry& e = i_map[key(node, buf)];
+		node->n_index_pos = e.nodes.size();
+		e.nodes.push_back(node);
+		++i_size;
+	}
+	void erase(xml_node<T>* node) { //削除するノードを外す (位置を保つためnullptrを残す)
+		xml_string<T> buf;
+		entry* e = find(key(node, buf));
+		if (e == nullptr || node->n_index_pos >= e->nodes.size() || e->nodes[node->n_index_pos] != node) return;
+		e->nodes[node->n_index_pos] = nullptr;
+		--i_size;
+		++i_dead;
+		while (e->head < e->nodes.size() && e->nodes[e->head] == nullptr) ++e->head;
+		while (!e->nodes.empty() && e->nodes.back() == nullptr) { e->nodes.pop_back(); --i_dead; }
+		if (e->head > e->nodes.size()) e->head = e->nodes.size();
+	}
+	xml_node<T>* first(const xml_string<T>& name) {
+		entry* e = find(name);
+		if (e == nullptr || e->head == e->nodes.size()) return nullptr;
+		return e->nodes[e->head];
+	}
+	xml_node<T>* last(const xml_string<T>& name) {
+		entry* e = find(name);
+		if (e == nullptr || e->nodes.empty()) return nullptr;
+		return e->nodes.back();
+	}
+	xml_node<T>* next(xml_node<T>* node) { //nodeの後ろの同名のノード (nodeは登録済み)
+		xml_string<T> buf;
+		entry* e = find(key(node, buf));
+		if (e == nullptr) return nullptr;
+		for (size_t i = node->n_index_pos + 1; i < e->nodes.size(); i++) if (e->nodes[i] != nullptr) return e->nodes[i];
+		return nullptr;
+	}
+	xml_node<T>* back(xml_node<T>* node) { //nodeの前の同名のノード (nodeは登録済み)
+		xml_string<T> buf;
+		entry* e = find(key(node, buf));
+		if (e == nullptr) return nullptr;
+		for (size_t i = node->n_index_pos; i-- > e->head;) if (e->nodes[i] != nullptr) return e->nodes[i];
+		return nullptr;
+	}
+};
+
+template <typename T = char>
+class xml_node : public xml_object<T> {
+	using xml_object<T>::o_name;
+	using xml_object<T>::o_value;
+	using xml_object<T>::o_atom;
+	using xml_object<T>::n_parent;
+	using xml_object<T>::set_name;
+	using xml_object<T>::set_atom;
+	using xml_object<T>::merge_name;
+	using xml_object<T>::match;
+
+	xml_node_type n_type;
+	xml_attribute_list<T> a_list;
+
+	xml_node<T>* n_back;
+	xml_node<T>* n_next;
+	xml_node<T>* n_first;
+	xml_node<T>* n_end;
+	xml_memory_pool* n_pool; //子ノード・属性の確保先
+	xml_atom_table<T>* n_atoms; //子ノード・属性の名前の表
+	xml_child_index<T>* n_index; //子ノードの名前の索引 (nullptr = 未作成)
+	size_t n_index_pos; //親ノードの索引での位置
+	size_t n_print_pos;  //前回の書き出し結果での位置 (親ノードの先頭から xml_document::print_cache有効時)
+	size_t n_print_size; //前回の書き出し結果での大きさ
+	bool n_dirty; //前回の書き出し以降に自分か子孫が変更された (trueなら祖先もtrue)
+	bool n_moved; //前回の書き出し以降に移動された (子孫の前回の書き出し結果は使えない)
+
+	friend class xml_attribute<T>;
+	friend class xml_document<T>;
+	friend class xml_child_index<T>;
+	friend class xml_query<T>;
+
+	void drop_index() { //索引を破棄 (次の名前つきの検索で作り直す)
+		delete n_index;
+		n_index = nullptr;
+	}
+	xml_child_index<T>* child_index() { //索引を取得 (未作成・削除が多い場合は作成)
+		if (n_index != nullptr && n_index->stale()) drop_index();
+		if (n_index == nullptr) n_index = new xml_child_index<T>(this);
+		return n_index;
+	}
+	template <typename F>
+	xml_node<T>* copy_node(xml_node<T>* parent, F& copy_text) { //自分だけをparentの末尾に複製 (copy_text(複製先, 複製元)で内容・属性値を設定)
+		xml_node<T>* node = new (parent->n_pool) xml_node<T>(xml_string<T>(), xml_string<T>(), n_type, parent, 1);
+		if (!o_name.empty()) {
+			if (o_atom != nullptr && o_atom->table() == node->n_atoms) node->set_atom(o_atom); //同じ名前の表ならそのまま参照
+			else node->set_name(o_name.data(), o_name.size(), node->n_atoms);
+		}
+		copy_text(node->o_value, o_value);
+		for (xml_attribute<T>* attr : a_list) {
+			xml_attribute<T>* copy = new (node->n_pool) xml_attribute<T>();
+			if (attr->o_atom != nullptr && attr->o_atom->table() == node->n_atoms) copy->set_atom(attr->o_atom);
+			else copy->set_name(attr->o_name.data(), attr->o_name.size(), node->n_atoms);
+			copy_text(copy->o_value, attr->o_value);
+			copy->n_parent = node;
+			node->a_list.push_back(copy);
+		}
+		return node;
+	}
+	template <typename F>
+	xml_node<T>* copy_tree(xml_node<T>* parent, F copy_text) { //部分木をparentの末尾に複製 (再帰せず、親ノードへのリンクで階層を移動する)
+		if (parent->n_type != normal && parent->n_type != document) return nullptr;
+		for (xml_node<T>* node = parent; node != nullptr; node = node->n_parent) if (node == this) return nullptr; //複製先が部分木の中
+		xml_node<T>* top = copy_node(parent, copy_text);
+		xml_node<T>* from = this;
+		xml_node<T>* to = top;
+		while (true) {
+			if (from->n_first != nullptr) { //子ノードの階層に移動
+				from = from->n_first;
+				to = from->copy_node(to, copy_text);
+				continue;
+			}
+			while (from != this && from->n_next == nullptr) { //親ノードの階層に戻る
+				from = from->n_parent;
+				to = to->n_parent;
+			}
+			if (from == this) break;
+			from = from->n_next;
+			to = from->copy_node(to->n_parent, copy_text);
+		}
+		return top;
+	}
+	void touch() { //変更を記録 (自分と祖先を書き出し直しの対象にする 変更済みの祖先で止まる)
+		for (xml_node<T>* node = this; node != nullptr && !node->n_dirty; node = node->n_parent) node->n_dirty = true;
+	}
+	void touch_all() { //部分木のすべてのノードを書き出し直しの対象にする (移動した部分木の書き出し時)
+		xml_node<T>* node = this;
+		while (true) {
+			node->n_dirty = true;
+			node->n_moved = false;
+			if (node->n_first != nullptr) { node = node->n_first; continue; }
+			while (node != this && node->n_next == nullptr) node = node->n_parent;
+			if (node == this) break;
+			node = node->n_next;
+		}
+	}
+	//移動処理
+	static void unlink_range(xml_node<T>* first, xml_node<T>* last) { //兄弟の範囲[first, last]を親ノード・前後のノードから外す (範囲内のつながりと部分木は残す)
+		xml_node<T>* parent = first->n_parent;
+		if (parent != nullptr) {
+			parent->touch();
+			if (parent->n_index != nullptr) {
+				if (first == last) parent->n_index->erase(first);
+				else parent->drop_index();
+			}
+			if (parent->n_first == first) parent->n_first = last->n_next;
+			if (parent->n_end == last) parent->n_end = first->n_back;
+		}
+		if (first->n_back != nullptr) first->n_back->n_next = last->n_next;
+		if (last->n_next != nullptr) last->n_next->n_back = first->n_back;
+		first->n_back = nullptr;
+		last->n_next = nullptr;
+	}
+	static void link_range(xml_node<T>* first, xml_node<T>* last, xml_node<T>* parent, xml_node<T>* back, xml_node<T>* next) { //範囲[first, last]をparentの子ノードのbackとnextの間につなぐ (nullptr = 先頭・末尾)
+		for (xml_node<T>* node = first; ; node = node->n_next) {
+			node->n_parent = parent;
+			node->n_dirty = true;
+			node->n_moved = true;
+			if (node == last) break;
+		}
+		first->n_back = back;
+		last->n_next = next;
+		if (back != nullptr) back->n_next = first; else parent->n_first = first;
+		if (next != nullptr) next->n_back = last; else parent->n_end = last;
+		//親ノードの索引を更新 (末尾への追加以外は作り直す)
+		if (parent->n_index != nullptr) {
+			if (next != nullptr) parent->drop_index();
+			else for (xml_node<T>* node = first; node != nullptr; node = node->n_next) parent->n_index->push_back(node);
+		}
+		parent->touch();
+	}
+	void adopt(xml_memory_pool* pool, xml_atom_table<T>* atoms) { //部分木の確保先・名前の表を移動先のものにする (ドキュメントに属さないノードの移動時)
+		xml_node<T>* node = this;
+		while (true) {
+			node->n_pool = pool;
+			node->n_atoms = atoms;
+			node->drop_index();
+			if (!node->o_name.empty() && (node->o_atom == nullptr || node->o_atom->table() != atoms)) node->set_name(node->o_name.data(), node->o_name.size(), atoms);
+			for (xml_attribute<T>* attr : node->a_list) {
+				if (attr->o_atom == nullptr || attr->o_atom->table() != atoms) attr->set_name(attr->o_name.data(), attr->o_name.size(), atoms);
+			}
+			if (node->n_first != nullptr) { node = node->n_first; continue; }
+			while (node != this && node->n_next == nullptr) node = node->n_parent;
+			if (node == this) break;
+			node = node->n_next;
+		}
+	}
+	//兄弟の範囲[first, last]の部分木をparentの子ノードに移動 (ref = nullptrは末尾、それ以外はrefの前(after = false)か後ろ 移動後の先頭ノード 移動できない場合はnullptr)
+	//同じドキュメント内ではつなぎ替えるだけで、範囲内のノードの親ノードだけを書き換える
+	//ドキュメントに属さないノード (new xml_node<T>で作成した部分木) は確保先・名前の表を移動先のものにする
+	//別のドキュメントのノードは確保先のプールが異なるため、複製して元の部分木を削除する
+	static xml_node<T>* move_range(xml_node<T>* first, xml_node<T>* last, xml_node<T>* parent, xml_node<T>* ref, bool after) {
+		if (parent->n_type != normal && parent->n_type != document) return nullptr;
+		if (ref != nullptr && ref->n_parent != parent) return nullptr;
+		//移動先が範囲の部分木の中にないか確認 (範囲と同じ階層の祖先を探す)
+		xml_node<T>* inner = nullptr;
+		for (xml_node<T>* node = parent; node != nullptr; node = node->n_parent) {
+			if (node->n_parent == first->n_parent) { inner = node; break; }
+		}
+		for (xml_node<T>* node = first; ; node = node->n_next) {
+			if (node == nullptr || node->n_type == document || node == inner || node == ref) return nullptr; //lastが後ろの兄弟でない・移動先が範囲の中
+			if (node == last) break;
+		}
+		if (first->n_pool != parent->n_pool && first->n_pool != nullptr) { //別のドキュメント
+			xml_node<T>* head = nullptr;
+			xml_node<T>* tail = nullptr;
+			for (xml_node<T>* node = first; ; ) {
+				xml_node<T>* next = node->n_next;
+				bool end = node == last;
+				tail = node->clone(parent);
+				if (head == nullptr) head = tail;
+				delete node;
+				if (end) break;
+				node = next;
+			}
+			if (ref == nullptr) return head;
+			first = head;
+			last = tail;
+		}
+		bool adopting = first->n_pool != parent->n_pool || first->n_atoms != parent->n_atoms;
+		unlink_range(first, last);
+		xml_node<T>* back = (ref == nullptr) ? parent->n_end : (after ? ref : ref->n_back);
+		xml_node<T>* next = (ref == nullptr) ? nullptr : (after ? ref->n_next : ref);
+		link_range(first, last, parent, back, next);
+		if (adopting) {
+			for (xml_node<T>* node = first; ; node = node->n_next) {
+				node->adopt(parent->n_pool, parent->n_atoms);
+				if (node == last) break;
+			}
+		}
+		return first;
+	}
+	bool indexed_sibling(const xml_string<T>& n) { //兄弟の検索に親ノードの索引を使えるか (同名のノードからの検索のみ)
+		return n_parent != nullptr && n_parent->n_index != nullptr && !n_parent->n_index->stale() && o_name == n;
+	}
+public:
+	xml_node() { n_back = nullptr; n_next = nullptr; n_parent = nullptr; n_first = nullptr; n_end = nullptr; n_pool = nullptr; n_atoms = nullptr; n_index = nullptr; n_print_pos = 0; n_print_size = 0; n_dirty = true; n_moved = false; n_type = normal; }
+	xml_node(xml_node_type t) { n_back = nullptr; n_next = nullptr; n_parent = nullptr; n_first = nullptr; n_end = nullptr; n_pool = nullptr; n_atoms = nullptr; n_index = nullptr; n_print_pos = 0; n_print_size = 0; n_dirty = true; n_moved = false; n_type = t; }
+	xml_node(xml_string<T> n, xml_string<T> v) {
+		o_name = std::move(n);
+		o_value = std::move(v);
+		n_type = normal;
+		n_back = nullptr;
+		n_next = nullptr;
+		n_parent = nullptr;
+		n_first = nullptr;
+		n_end = nullptr;
+		n_pool = nullptr;
+		n_atoms = nullptr;
+		n_index = nullptr;
+		n_print_pos = 0;
+		n_print_size = 0;
+		n_dirty = true;
+		n_moved = false;
+	}
+	xml_node(const xml_string<T>& n, xml_string<T> v, xml_node_type t, xml_node<T>* node, int flag = 1) {
+		n_type = t;
+		switch (t) {
+			case comment: case doctype: case pi:
+				o_value = std::move(v);
+				break;
+			case normal:
+				set_name(n.data(), n.size(), node->n_atoms);
+				o_value = std::move(v);
+				break;
+			default: break;
+		}
+		n_first = nullptr;
+		n_end = nullptr;
+		n_pool = node->n_pool;
+		n_atoms = node->n_atoms;
+		n_index = nullptr;
+		n_print_pos = 0;
+		n_print_size = 0;
+		n_dirty = true;
+		n_moved = false;
+		n_parent = nullptr;
+		n_back = nullptr;
+		n_next = nullptr;
+		if (flag <= 1) {
+			//nodeを親ノードとして登録
+			n_parent = node;
+			if (n_parent->n_first == nullptr) {
+				//親ノードに登録しているノードが一つもない
+				n_parent->n_first = this;
+				n_parent->n_end = this;
+				n_back = nullptr;
+				n_next = nullptr;
+			} else if (flag <= 0) {
+				// -0 最前列に追加
+				n_parent->n_first->n_back = this;
+				n_back = nullptr;
+				n_next = n_parent->n_first;
+				n_parent->n_first = this;
+			} else {
+				// 1 最後尾に追加
+				n_parent->n_end->n_next = this;
+				n_back = n_parent->n_end;
+				n_next = nullptr;
+				n_parent->n_end = this;
+			}
+		} else if (node->n_parent != nullptr) {
+			//nodeの前後に自分を配置
+			n_parent = node->n_parent;
+			if (flag == 2) {
+				// 2 nodeの前に配置
+				if (node->n_next == nullptr) {
+					//最後尾に配置
+					n_parent->n_end = this;
+					node->n_next = this;
+					n_back = node;
+					n_next = nullptr;
+				} else {
+					n_back = node;
+					n_next = node->n_next;
+					n_back->n_next = this;
+					n_next->n_back = this;
+				}
+			} else {
+				// 3- nodeの後ろに配置
+				if (node->n_back == nullptr) {
+					//最前列に配置
+					n_parent->n_first = this;
+					node->n_back = this;
+					n_back = nullptr;
+					n_next = node;
+				} else {
+					n_back = node->n_back;
+					n_next = node;
+					n_back->n_next = this;
+					n_next->n_back = this;
+				}
+			}
+		}
+		//親ノードの索引を更新 (末尾への追加以外は作り直す)
+		if (n_parent != nullptr && n_parent->n_index != nullptr) {
+			if (n_next == nullptr) n_parent->n_index->push_back(this);
+			else n_parent->drop_index();
+		}
+		if (n_parent != nullptr) n_parent->touch();
+	}
+	~xml_node() { clear(); }
+
+	void clear() {
+		delete_all_children(); //子ノードをすべて削除
+		delete_all_attribute(); //属性をすべて削除
+		drop_index();
+		unlink_range(this, this); //親ノード・前後のノードとのリンクをクリア
+		n_parent = nullptr;
+	}
+
+	//取得・編集
+	xml_node_type type() { return n_type; }
+	void type(xml_node_type t) {
+		n_type = t;
+		touch();
+		if (t != normal) o_value.decode(); //normal以外の内容はそのまま書き出すため、未変換の特殊文字を変換しておく
+		if (t == document) delete_all_attribute();
+		else if (t == comment || t == doctype) {
+			delete_all_children();
+			delete_all_attribute();
+		}
+	}
+	xml_obj_type obj_type() { return node; }
+	using xml_object<T>::name;
+	using xml_object<T>::value;
+	void name(const xml_string<T>& n) {
+		if (n_type != normal && n_type != pi) return;
+		if (n_parent != nullptr) n_parent->drop_index(); //親ノードの索引は名前で分類しているため作り直す
+		set_name(n.data(), n.size(), n_atoms);
+		touch();
+	}
+	void value(xml_string<T> v) {
+		if (n_type != normal && n_type != comment && n_type != doctype) return;
+		o_value = std::move(v);
+		touch();
+	}
+	void add_value(xml_string<T> v) {
+		if (n_type != normal && n_type != comment && n_type != doctype) return;
+		o_value.append(std::move(v));
+		touch();
+	}
+	//子ノード取得
+	xml_node<T>* first_child() {
+		if (n_type == document || n_type == normal) return n_first; //子ノードが存在するタイプのみ
+		return nullptr;
+	}
+	xml_node<T>* first_child(const xml_string<T>& n) {
+		if (n_type == document || n_type == normal) { //子ノードが存在するタイプのみ
+			if (n_index != nullptr) return child_index()->first(n); //索引で検索
+			//検索 (多くの兄弟をたどった場合は索引を作成)
+			xml_node<T>* find_node = n_first;
+			for (size_t count = 0; find_node != nullptr; count++) {
+				if (find_node->o_name == n) return find_node; //タグ名が一致するか判定
+				if (count == xml_child_index<T>::threshold) return child_index()->first(n);
+				find_node = find_node->n_next; //次のノード
+			}
+		}
+		return nullptr;
+	}
+	xml_node<T>* first_child(const xml_atom<T>* n) { //名前の表の名前で検索 (n = nullptrはnullptr)
+		if (n != nullptr && (n_type == document || n_type == normal)) { //子ノードが存在するタイプのみ
+			if (n_index != nullptr) return child_index()->first(n->name()); //索引で検索
+			//検索 (多くの兄弟をたどった場合は索引を作成)
+			xml_node<T>* find_node = n_first;
+			for (size_t count = 0; find_node != nullptr; count++) {
+				if (find_node->match(n)) return find_node; //タグ名が一致するか判定
+				if (count == xml_child_index<T>::threshold) return child_index()->first(n->name());
+				find_node = find_node->n_next; //次のノード
+			}
+		}
+		return nullptr;
+	}
+	xml_node<T>* end_child() {
+		if (n_type == document || n_type == normal) return n_end; //子ノードが存在するタイプのみ
+		return nullptr;
+	}
+	xml_node<T>* end_child(const xml_string<T>& n) {
+		if (n_type == document || n_type == normal) { //子ノードが存在するタイプのみ
+			if (n_index != nullptr) return child_index()->last(n); //索引で検索
+			//検索 (多くの兄弟をたどった場合は索引を作成)
+			xml_node<T>* find_node = n_end;
+			for (size_t count = 0; find_node != nullptr; count++) {
+				if (find_node->o_name == n) return find_node; //タグ名が一致するか判定
+				if (count == xml_child_index<T>::threshold) return child_index()->last(n);
+				find_node = find_node->n_back; //前のノード
+			}
+		}
+		return nullptr;
+	}
+	xml_node<T>* end_child(const xml_atom<T>* n) { //名前の表の名前で検索 (n = nullptrはnullptr)
+		if (n != nullptr && (n_type == document || n_type == normal)) { //子ノードが存在するタイプのみ
+			if (n_index != nullptr) return child_index()->last(n->name()); //索引で検索
+			//検索 (多くの兄弟をたどった場合は索引を作成)
+			xml_node<T>* find_node = n_end;
+			for (size_t count = 0; find_node != nullptr; count++) {
+				if (find_node->match(n)) return find_node; //タグ名が一致するか判定
+				if (count == xml_child_index<T>::threshold) return child_index()->last(n->name());
+				find_node = find_node->n_back; //前のノード
+			}
+		}
+		return nullptr;
+	}
+	//次のノード取得
+	xml_node<T>* next_node() { return n_next; }
+	xml_node<T>* next_node(const xml_string<T>& n) {
+		if (indexed_sibling(n)) return n_parent->n_index->next(this); //親ノードの索引で検索
+		xml_node<T>* find_node = n_next;
+		while (find_node != nullptr) {
+			if (find_node->o_name == n) return find_node; //タグ名が一致するか判定
+			find_node = find_node->n_next; //次のノード
+		}
+		return nullptr;
+	}
+	xml_node<T>* next_node(const xml_atom<T>* n) { //名前の表の名前で検索 (n = nullptrはnullptr)
+		if (n == nullptr) return nullptr;
+		if (indexed_sibling(n->name())) return n_parent->n_index->next(this); //親ノードの索引で検索
+		xml_node<T>* find_node = n_next;
+		while (find_node != nullptr) {
+			if (find_node->match(n)) return find_node; //タグ名が一致するか判定
+			find_node = find_node->n_next; //次のノード
+		}
+		return nullptr;
+	}
+	//前のノード取得
+	xml_node<T>* back_node() { return n_back; }
+	xml_node<T>* back_node(const xml_string<T>& n) {
+		if (indexed_sibling(n)) return n_parent->n_index->back(this); //親ノードの索引で検索
+		xml_node<T>* find_node = n_back;
+		while (find_node != nullptr) {
+			if (find_node->o_name == n) return find_node; //タグ名が一致するか判定
+			find_node = find_node->n_back; //前のノード
+		}
+		return nullptr;
+	}
+	xml_node<T>* back_node(const xml_atom<T>* n) { //名前の表の名前で検索 (n = nullptrはnullptr)
+		if (n == nullptr) return nullptr;
+		if (indexed_sibling(n->name())) return n_parent->n_index->back(this); //親ノードの索引で検索
+		xml_node<T>* find_node = n_back;
+		while (find_node != nullptr) {
+			if (find_node->match(n)) return find_node; //タグ名が一致するか判定
+			find_node = find_node->n_back; //前のノード
+		}
+		return nullptr;
+	}
+	//属性取得
+	xml_attribute<T>* first_attribute() {
+		if ((n_type == normal || n_type == pi) && !a_list.empty()) return a_list[0];
+		return nullptr;
+	}
+	xml_attribute<T>* end_attribute() {
+		if ((n_type == normal || n_type == pi) && !a_list.empty()) return a_list[a_list.size() - 1];
+		return nullptr;
+	}
+	size_t attribute_size() { return a_list.size(); } //属性の数
+	xml_attribute<T>* attribute(size_t index) { //index番目の属性 (追加順)
+		if (index < a_list.size()) return a_list[index];
+		return nullptr;
+	}
+	xml_attribute<T>* find_attribute(const xml_string<T>& n) { //指定の属性を検索して取得
+		if ((n_type == normal || n_type == pi) && !a_list.empty()) return a_list.find(n.data(), n.size()); //検索
+		return nullptr;
+	}
+	xml_attribute<T>* find_attribute(const xml_atom<T>* n) { //名前の表の名前で検索 (n = nullptrはnullptr)
+		if (n != nullptr && (n_type == normal || n_type == pi) && !a_list.empty()) return a_list.find(n); //検索
+		return nullptr;
+	}
+	//追加
+	xml_node<T>* add_first_child(const xml_string<T>& n, xml_string<T> v, xml_node_type t = normal) {
+		xml_node<T>* out = new (n_pool) xml_node<T>(n, std::move(v), t, this, 0);
+		return out;
+	}
+	xml_node<T>* add_end_child(const xml_string<T>& n, xml_string<T> v, xml_node_type t = normal) {
+		xml_node<T>* out = new (n_pool) xml_node<T>(n, std::move(v), t, this, 1);
+		return out;
+	}
+	xml_node<T>* add_next_node(const xml_string<T>& n, xml_string<T> v, xml_node_type t = normal) {
+		xml_node<T>* out = new (n_pool) xml_node<T>(n, std::move(v), t, this, 2);
+		return out;
+	}
+	xml_node<T>* add_back_node(const xml_string<T>& n, xml_string<T> v, xml_node_type t = normal) {
+		xml_node<T>* out = new (n_pool) xml_node<T>(n, std::move(v), t, this, 3);
+		return out;
+	}
+	xml_attribute<T>* add_attribute(const xml_string<T>& n, xml_string<T> v) {
+		if (n_type != normal && n_type != pi) return nullptr;
+		xml_attribute<T>* attr = find_attribute(n);
+		if (attr != nullptr) attr->value(std::move(v)); //既に存在する属性に上書き
+		else attr = new (n_pool) xml_attribute<T>(n, std::move(v), this); //新規作成
+		return attr;
+	}
+	xml_node<T>* clone(xml_node<T>* parent) { //部分木をparentの末尾の子ノードとして複製 (別のドキュメントのノードも指定できる parentが部分木の中ならnullptr)
+		return copy_tree(parent, [](xml_text<T>& to, const xml_text<T>& from) {
+			to.assign(from.data(), from.size());
+			if (from.is_raw()) to.raw();
+		});
+	}
+	template <typename I>
+	xml_node<T>* add_end_children(I first, I last, xml_node_type t = normal) { //[first, last)の名前と内容の組(pair)からまとめて末尾に追加 (最初に追加したノード 右辺値の内容は領域を引き継ぐ)
+		if (n_type != normal && n_type != document) return nullptr;
+		drop_index(); //名前つきの検索で作り直す
+		xml_node<T>* head = nullptr;
+		const xml_atom<T>* atom = nullptr; //直前の名前 (同じ名前が続く場合は名前の表を検索しない)
+		for (; first != last; ++first) {
+			auto&& item = *first;
+			xml_node<T>* node = new (n_pool) xml_node<T>(xml_string<T>(), xml_string<T>(std::forward<decltype(item)>(item).second), t, this, 1);
+			if (t == normal) {
+				if (atom != nullptr && atom->name() == item.first) node->set_atom(atom);
+				else {
+					node->set_name(item.first.data(), item.first.size(), n_atoms);
+					atom = node->o_atom;
+				}
+			}
+			if (head == nullptr) head = node;
+		}
+		return head;
+	}
+	//移動
+	xml_node<T>* detach() { //親ノードから切り離す (部分木は残る append_childなどで同じドキュメントに戻すか、deleteで削除する)
+		if (n_type == document) return nullptr;
+		unlink_range(this, this);
+		n_parent = nullptr;
+		n_moved = true;
+		return this;
+	}
+	//移動した部分木 (別のドキュメントのノードは複製したもの) を返す (移動できない場合はnullptr)
+	xml_node<T>* append_child(xml_node<T>* node) { //nodeの部分木を末尾の子ノードに移動
+		if (node == nullptr) return nullptr;
+		return move_range(node, node, this, nullptr, false);
+	}
+	xml_node<T>* append_children(xml_node<T>* first, xml_node<T>* last = nullptr) { //兄弟の範囲[first, last]をまとめて末尾の子ノードに移動 (last = nullptrは最後の兄弟まで 移動後の先頭ノード)
+		if (first == nullptr) return nullptr;
+		if (last == nullptr) last = (first->n_parent != nullptr) ? first->n_parent->n_end : first;
+		return move_range(first, last, this, nullptr, false);
+	}
+	xml_node<T>* insert_before(xml_node<T>* node) { //nodeの部分木を自分の前に移動
+		if (node == nullptr || n_parent == nullptr) return nullptr;
+		if (node == this) return this;
+		return move_range(node, node, n_parent, this, false);
+	}
+	xml_node<T>* insert_after(xml_node<T>* node) { //nodeの部分木を自分の後ろに移動
+		if (node == nullptr || n_parent == nullptr) return nullptr;
+		if (node == this) return this;
+		return move_range(node, node, n_parent, this, true);
+	}
+	//ノード削除
+	xml_node<T>* delete_first_child() {
+		if (n_type != normal && n_type != document) return nullptr;
+		xml_node<T>* out = nullptr;
+		xml_node<T>* node = n_first;
+		if (node->type() != document && node != nullptr) { out = node->next_node(); delete node; }
+		return out;
+	}
+	xml_node<T>* delete_first_child(const xml_string<T>& n) {
+		if (n_type != normal && n_type != document) return nullptr;
+		xml_node<T>* out = nullptr;
+		xml_node<T>* node = first_child(n);
+		//検索 (名前つきの検索で索引を利用)
+		while (node != nullptr && node->type() != normal && node->type() != pi) node = node->next_node(n);
+		if (node != nullptr) { out = node->next_node(); delete node; }
+		return out;
+	}
+	xml_node<T>* delete_first_child(const xml_atom<T>* n) { //名前の表の名前で検索
+		if (n_type != normal && n_type != document) return nullptr;
+		xml_node<T>* out = nullptr;
+		xml_node<T>* node = first_child(n);
+		//検索 (名前つきの検索で索引を利用)
+		while (node != nullptr && node->type() != normal && node->type() != pi) node = node->next_node(n);
+		if (node != nullptr) { out = node->next_node(); delete node; }
+		return out;
+	}
+	xml_node<T>* delete_end_child() {
+		if (n_type != normal && n_type != document) return nullptr;
+		xml_node<T>* out = nullptr;
+		xml_node<T>* node = n_end;
+		if (node->type() != document && node != nullptr) { out = node->back_node(); delete node; }
+		return out;
+	}
+	xml_node<T>* delete_end_child(const xml_string<T>& n) {
+		if (n_type != normal && n_type != document) return nullptr;
+		xml_node<T>* out = nullptr;
+		xml_node<T>* node = end_child(n);
+		//検索 (名前つきの検索で索引を利用)
+		while (node != nullptr && node->type() != normal && node->type() != pi) node = node->back_node(n);
+		if (node != nullptr) { out = node->back_node(); delete node; }
+		return out;
+	}
+	xml_node<T>* delete_end_child(const xml_atom<T>* n) { //名前の表の名前で検索
+		if (n_type != normal && n_type != document) return nullptr;
+		xml_node<T>* out = nullptr;
+		xml_node<T>* node = end_child(n);
+		//検索 (名前つきの検索で索引を利用)
+		while (node != nullptr && node->type() != normal && node->type() != pi) node = node->back_node(n);
+		if (node != nullptr) { out = node->back_node(); delete node; }
+		return out;
+	}
+	void delete_all_children() { //子ノードをすべて削除 (再帰せず、末端のノードから順に削除)
+		if ((n_type != normal && n_type != document) || n_first == nullptr) return;
+		drop_index(); //1つずつ索引から外さずにまとめて破棄
+		touch();
+		xml_node<T>* node = n_first;
+		while (node != this) {
+			if (node->n_first != nullptr) { node = node->n_first; continue; } //子ノードを先に削除
+			xml_node<T>* parent = node->n_parent;
+			xml_node<T>* next = node->n_next;
+			delete node; //親ノードとのリンクは削除時に修正される
+			node = (next != nullptr) ? next : parent;
+		}
+		n_first = nullptr;
+		n_end = nullptr;
+	}
+	xml_node<T>* delete_next_node() {
+		if (n_type == document || n_next == nullptr) return nullptr;
+		xml_node<T>* out = n_next->next_node();
+		delete n_next;
+		return out;
+	}
+	xml_node<T>* delete_next_node(const xml_string<T>& n) {
+		xml_node<T>* out = nullptr;
+		xml_node<T>* node = next_node(n);
+		//検索 (名前つきの検索で索引を利用)
+		while (node != nullptr && node->type() != normal && node->type() != pi) node = node->next_node(n);
+		if (node != nullptr) { out = node->next_node(); delete node; }
+		return out;
+	}
+	xml_node<T>* delete_next_node(const xml_atom<T>* n) { //名前の表の名前で検索
+		xml_node<T>* out = nullptr;
+		xml_node<T>* node = next_node(n);
+		//検索 (名前つきの検索で索引を利用)
+		while (node != nullptr && node->type() != normal && node->type() != pi) node = node->next_node(n);
+		if (node != nullptr) { out = node->next_node(); delete node; }
+		return out;
+	}
+	xml_node<T>* delete_back_node() {
+		if (n_type == document || n_back == nullptr) return nullptr;
+		xml_node<T>* out = n_back->back_node();
+		delete n_back;
+		return out;
+	}
+	xml_node<T>* delete_back_node(const xml_string<T>& n) {
+		xml_node<T>* out = nullptr;
+		xml_node<T>* node = back_node(n);
+		//検索 (名前つきの検索で索引を利用)
+		while (node != nullptr && node->type() != normal && node->type() != pi) node = node->back_node(n);
+		if (node != nullptr) { out = node->back_node(); delete node; }
+		return out;
+	}
+	xml_node<T>* delete_back_node(const xml_atom<T>* n) { //名前の表の名前で検索
+		xml_node<T>* out = nullptr;
+		xml_node<T>* node = back_node(n);
+		//検索 (名前つきの検索で索引を利用)
+		while (node != nullptr && node->type() != normal && node->type() != pi) node = node->back_node(n);
+		if (node != nullptr) { out = node->back_node(); delete node; }
+		return out;
+	}
+	//属性削除
+	void delete_attribute(const xml_string<T>& n) { //指定した属性を削除
+		if (a_list.empty()) return;
+		xml_attribute<T>* attr = find_attribute(n);
+		if (attr != nullptr) delete attr; //削除時に一覧から外れる
+	}
+	void delete_all_attribute() { //属性をすべて削除
+		if (a_list.empty()) return;
+		touch();
+		for (xml_attribute<T>* attr : a_list) {
+			attr->n_parent = nullptr;
+			delete attr;
+		}
+		a_list.clear();
+	}
+};
+
+//バイナリ形式のスナップショット (xml_document::snapshotで作成し、load_snapshot・xml_snapshotで読み込む)
+//[ヘッダー][名前][ノード][属性][文字列表] の順に並び、名前・ノード・属性は番号、文字列は文字列表の位置で参照する
+struct xml_snapshot_format {
+	static const uint32_t version_number = 2;
+	static const uint32_t byte_order_mark = 0x01020304;
+	static const uint32_t none = 0xFFFFFFFF; //参照なし
+
+	struct text { //文字列表の範囲 (文字数 各文字列の後ろに'\0'がある)
+		uint64_t offset;
+		uint64_t size;
+	};
+	struct header {
+		char magic[4];            //"XMLS"
+		uint32_t version;         //version_number
+		uint32_t byte_order;      //byte_order_mark (作成した環境のバイト順)
+		uint32_t char_size;       //文字型の大きさ (xml_document<T>のsizeof(T))
+		uint32_t node_count;      //ノードの数 (文書順 0番目はドキュメント)
+		uint32_t attribute_count; //属性の数 (ノードの順に連続)
+		uint32_t name_count;      //名前の数 (ノード・属性の名前は重複しない)
+		uint32_t reserved;
+		uint64_t string_size;     //文字列表の文字数
+	};
+	struct node {
+		uint32_t type;            //xml_node_type
+		uint32_t name;            //名前の番号
+		uint32_t parent;          //ノードの番号
+		uint32_t first;
+		uint32_t end;
+		uint32_t next;
+		uint32_t back;
+		uint32_t attribute;       //最初の属性の番号
+		uint32_t attribute_count;
+		uint32_t reserved;
+		text value;
+	};
+	struct attribute {
+		uint32_t name;
+		uint32_t reserved;
+		text value;
+	};
+	struct layout { //各部分の先頭
+		const header* head;
+		const text* names;
+		const node* nodes;
+		const attribute* attributes;
+		const char* strings; //文字列表 (xml_document<T>のTの配列)
+	};
+
+	static bool check_text(const text& t, uint64_t string_size) { return t.offset <= string_size && t.size <= string_size - t.offset; }
+	static bool check_link(uint32_t index, uint32_t count) { return index == none || index < count; }
+	static bool read(const char* data, size_t size, size_t char_size, layout& out) { //形式を検証して各部分の位置を取得 (dataは8byte境界に置くこと)
+		if (data == nullptr || ((uintptr_t)data & 7) != 0 || size < sizeof(header)) return false;
+		const header* head = (const header*)data;
+		if (char_traits<char>::compare(head->magic, "XMLS", 4) != 0 || head->version != version_number || head->byte_order != byte_order_mark) return false;
+		if (head->char_size != char_size) return false; //別の文字型で作成したスナップショット
+		if (head->node_count == 0 || head->node_count == none || head->attribute_count == none || head->name_count == none) return false;
+		uint64_t pos = sizeof(header);
+		uint64_t names = pos;      pos += (uint64_t)head->name_count * sizeof(text);
+		uint64_t nodes = pos;      pos += (uint64_t)head->node_count * sizeof(node);
+		uint64_t attributes = pos; pos += (uint64_t)head->attribute_count * sizeof(attribute);
+		if (pos > size || head->string_size > (size - pos) / char_size) return false;
+		out.head = head;
+		out.names = (const text*)(data + names);
+		out.nodes = (const node*)(data + nodes);
+		out.attributes = (const attribute*)(data + attributes);
+		out.strings = data + pos;
+		//各レコードの参照先
+		for (uint32_t i = 0; i < head->name_count; i++) if (!check_text(out.names[i], head->string_size)) return false;
+		for (uint32_t i = 0; i < head->attribute_count; i++) {
+			if (out.attributes[i].name >= head->name_count || !check_text(out.attributes[i].value, head->string_size)) return false;
+		}
+		for (uint32_t i = 0; i < head->node_count; i++) {
+			const node& n = out.nodes[i];
+			if (i == 0) {
+				if (n.type != document || n.parent != none || n.next != none || n.back != none) return false;
+			} else if (n.type == document || n.type > pi || n.parent >= i) return false; //親ノードは文書順で前にある
+			else if (out.nodes[n.parent].type != normal && out.nodes[n.parent].type != document) return false;
+			if (!check_link(n.name, head->name_count) || !check_link(n.first, head->node_count) || !check_link(n.end, head->node_count)) return false;
+			if (!check_link(n.next, head->node_count) || !check_link(n.back, head->node_count)) return false;
+			//子ノード・兄弟のつながり (first・next・endは後ろ、backは前のノードを指し、互いに一致すること 循環したつながりで検索が終わらなくなるのを防ぐ)
+			if ((n.first == none) != (n.end == none)) return false;
+			if (n.first != none) {
+				if (n.first <= i || n.end < n.first) return false;
+				if (out.nodes[n.first].parent != i || out.nodes[n.first].back != none || out.nodes[n.end].parent != i || out.nodes[n.end].next != none) return false;
+			}
+			if (i != 0) {
+				const node& p = out.nodes[n.parent];
+				if (n.back == none ? p.first != i : (n.back >= i || out.nodes[n.back].parent != n.parent || out.nodes[n.back].next != i)) return false;
+				if (n.next == none ? p.end != i : (n.next <= i || out.nodes[n.next].parent != n.parent || out.nodes[n.next].back != i)) return false;
+			}
+			if (n.attribute_count != 0 && (n.attribute >= head->attribute_count || n.attribute_count > head->attribute_count - n.attribute)) return false;
+			if (!check_text(n.value, head->string_size)) return false;
+		}
+		return true;
+	}
+};
+
+//読み込み・書き出しの統計 (xml_document::statsで指定した場合だけ、parse・printの度に上書きする)
+struct xml_stats {
+	//読み込み
+	size_t parse_bytes;     //読み込んだbyte数
+	size_t elements;        //通常のノードの数
+	size_t attributes;      //属性の数
+	size_t texts;           //内容を持つ通常のノードの数
+	size_t comments;
+	size_t pis;
+	size_t doctypes;
+	size_t max_depth;       //ノードの階層の最大
+	size_t entities;        //読み込み時に変換・確認した特殊文字の数
+	size_t allocations;     //ヒープからの確保の回数 (プールのブロック・プール外のノードと属性・内容の文字列から推定)
+	size_t allocated_bytes; //ヒープから確保したbyte数 (同上)
+	double open_ms;         //ファイルを開く時間 (parse_file)
+	double parse_ms;        //読み込みの時間
+	int error;              //読み込みの結果
+	size_t error_offset;    //エラーを検出した位置 (先頭からの文字数 エラーなしはnpos)
+	//書き出し
+	size_t print_bytes;     //書き出したbyte数
+	double print_ms;        //書き出しの時間
+
+	xml_stats() { clear_parse(); clear_print(); }
+	void clear_parse() {
+		parse_bytes = 0; elements = 0; attributes = 0; texts = 0; comments = 0; pis = 0; doctypes = 0; max_depth = 0; entities = 0;
+		allocations = 0; allocated_bytes = 0; open_ms = 0; parse_ms = 0; error = 0; error_offset = string::npos;
+	}
+	void clear_print() { print_bytes = 0; print_ms = 0; }
+};
+
+template <typename T = char>
+class xml_document {
+	xml_memory_pool d_pool; //ノード・属性の確保先 (docより先に宣言し、後に破棄する)
+	xml_atom_table<T> d_atoms; //ノード・属性の名前の表 (docより先に宣言し、後に破棄する)
+	xml_node<T> doc;
+	xml_string<T> d_source; //in-situ読み込みの読み込み元 (ノード・属性はこの範囲を参照する)
+	const char* d_map; //parse_file・load_snapshot_fileでメモリマップしたファイル (ノード・属性はこの範囲を参照する)
+	size_t d_map_size;
+	bool d_insitu;   //in-situ読み込み中
+	bool d_lazy_decode; //特殊文字の変換を内容の取得時まで遅らせる
+	size_t d_max_depth; //読み込むノードの階層の上限 (0 = 上限なし)
+	vector<unique_ptr<xml_memory_pool>> d_pools; //parse_parallelで区間ごとに使用した確保先 (clearで解放)
+	shared_ptr<const xml_string<T>> d_shared; //shareでまとめた内容 (clone(out, true)の複製先と共有する)
+	vector<shared_ptr<const xml_string<T>>> d_borrowed; //複製元と共有している内容 (ノード・属性はこの範囲を参照する)
+	bool d_print_cache; //書き出し結果を保存し、次の書き出しで変更のない部分木を複写する
+	bool d_print_ready; //d_print_textが前回の書き出し結果
+	xml_string<T> d_print_text; //前回の書き出し結果 (各ノードはn_print_pos・n_print_sizeで自分の範囲を記録する)
+	int d_print_indent; //前回の書き出しの設定
+	xml_string<T> d_print_indenttext;
+	size_t d_error_offset; //直前の読み込みでエラーを検出した位置
+	xml_stats* d_stats; //統計の記録先 (nullptr = 記録しない)
+	chrono::steady_clock::time_point d_stats_start; //計測中の処理の開始時刻
+#ifdef XML_USE_THREAD
+	atomic<size_t> d_entities; //読み込んだ特殊文字の数 (統計が有効な場合だけ数える parse_parallelでは複数のスレッドから加算する)
+#else
+	size_t d_entities;
+#endif
+
+	struct xml_segment { //parse_parallelで1つのスレッドが読み込む区間
+		size_t begin, end;
+		xml_atom_table<T> atoms; //区間のノード・属性の名前の表 (rootより先に宣言し、後に破棄する)
+		xml_node<T> root; //区間の子ノードを一時的に保持する親ノード
+		int err;
+	};
+	static const size_t parallel_min = 1024 * 1024; //parse_parallelで分割する最小の大きさ
+
+	void close_source() { //読み込み元を解放
+		xml_string<T>().swap(d_source);
+#ifdef XML_USE_POSIX
+		if (d_map != nullptr) munmap((void*)d_map, d_map_size);
+#endif
+		d_map = nullptr;
+		d_map_size = 0;
+	}
+
+	int open_file(const string& path, const char*& data, size_t& size) { //ファイルを読み込み元にする (sizeはbyte数 -7 = ファイルを開けない)
+#ifdef XML_USE_POSIX
+		data = (const char*)d_source.data();
+		size = 0;
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return -7;
+		struct stat st;
+		if (::fstat(fd, &st) != 0) { ::close(fd); return -7; }
+		if (st.st_size == 0) { ::close(fd); return 0; } //空のファイル
+		void* map = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (map == MAP_FAILED) return -7;
+		::madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL); //先頭から順に読み込む
+		d_map = (const char*)map;
+		d_map_size = (size_t)st.st_size;
+		data = d_map;
+		size = d_map_size;
+#else
+		//メモリマップが利用できない環境ではファイル全体を読み込んで保持する
+		ifstream ifs(path.c_str(), ios::binary);
+		if (!ifs) return -7;
+		string bytes((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+		d_source.assign((bytes.size() + sizeof(T) - 1) / sizeof(T), T()); //Tの境界に置く
+		if (!bytes.empty()) char_traits<char>::copy((char*)&d_source[0], bytes.data(), bytes.size());
+		data = (const char*)d_source.data();
+		size = bytes.size();
+#endif
+		return 0;
+	}
+
+	template <typename F>
+	void each_text(F f) { //すべてのノードの内容・属性値
+		xml_node<T>* node = doc.n_first;
+		while (node != nullptr) {
+			f(node->o_value);
+			for (xml_attribute<T>* attr : node->a_list) f(attr->o_value);
+			if (node->n_first != nullptr) { node = node->n_first; continue; }
+			while (node != &doc && node->n_next == nullptr) node = node->n_parent;
+			node = (node != &doc) ? node->n_next : nullptr;
+		}
+	}
+	void release_object(xml_object<T>* obj) { //一括解放用 プールの領域はrelease()でまとめて解放
+		if (xml_memory_pool::owner(obj) == &d_pool) obj->~xml_object();
+		else delete obj;
+	}
+
+	friend class xml_push_parser<T>;
+
+	static int espape_decode(const xml_source<T>& xml, size_t& pos, xml_string<T>& value) { //posの'&'から1つの特殊文字を変換してvalueに追加
+		T buf[xml_entity::max_units];
+		const T* p = xml.data() + pos;
+		int len = xml_entity::decode(p, xml.data() + xml.size(), buf);
+		if (len < 0) return len;
+		value.append(buf, len);
+		pos = p - xml.data();
+		return 0;
+	}
+	static int espape_skip(const xml_source<T>& xml, size_t& pos) { //posの'&'の特殊文字の書式を確認して次に進め、変換後の文字数を返す (変換はしない)
+		T buf[xml_entity::max_units];
+		const T* p = xml.data() + pos;
+		int len = xml_entity::decode(p, xml.data() + xml.size(), buf);
+		if (len > 0) pos = p - xml.data();
+		return len;
+	}
+	//読み込み処理
+	void set_text(xml_text<T>& text, const xml_source<T>& xml, size_t start, size_t len) { //読み込んだ範囲を設定
+		if (d_insitu) text.refer(xml.data() + start, len); //読み込み元を参照
+		else text = xml.substr(start, len);
+	}
+	template <int F>
+	int parse_type(const xml_source<T>& xml, size_t& pos, xml_node<T>*& parent, size_t& depth) { //'<'の次から1つのタグを読み込み、階層を移動する
+		int err = 0;
+		xml_node<T>* node = nullptr;
+		if (xml[pos] == '/') { //終了タグ
+			++pos;
+			if (parent == &doc) return 0; //対応する開始タグがない場合は無視
+			err = parse_end_tag(xml, pos, parent);
+			if (err < 0) return err;
+			parent = parent->n_parent; //親の階層に戻る
+			--depth;
+		} else if (xml[pos] == '!') {
+			if (pos+2 < xml.size() && xml[pos+1] == '-' && xml[pos+2] == '-')  { pos += 3; err = parse_comment<F>(xml, pos, parent); }
+			else if (xml.compare(pos+1, 8, "DOCTYPE ") == 0) { pos += 9; err = parse_doctype<F>(xml, pos, parent); }
+			else if ((F & parse_no_cdata) && xml.compare(pos+1, 7, "[CDATA[") == 0) { //子ノードの後のCDATA (parse_no_cdataのみ読み飛ばし、それ以外は-1)
+				pos = xml.find("]]>", pos + 8);
+				if (pos == string::npos) return -1; //タグの終端が存在しない
+				pos += 3;
+			}
+			else err = -1; //該当タグなし
+		} else if (xml[pos] == '?') { ++pos; err = parse_pi<F>(xml, pos, parent); }
+		else {
+			err = parse_node<F>(xml, pos, parent, node);
+			if (err == 1) {
+				//子ノード・終了タグの階層に移動
+				if (d_max_depth != 0 && depth >= d_max_depth) return -8; //階層が深すぎる
+				parent = node;
+				++depth;
+				err = 0;
+			}
+		}
+		return err;
+	}
+	int parse_name(const xml_source<T>& xml, size_t& pos, size_t& start, size_t& len) { //名前の範囲を取得
+		start = pos;
+		len = 0;
+		//タグ名 (終端文字まで進める)
+		pos = xml_scan::find_name_end(xml.data() + pos, xml.data() + xml.size()) - xml.data();
+		if (pos < xml.size()) {
+			switch (xml[pos]) {
+				case ' ': case '\t': case '\n':
+					len = pos - start;
+					++pos;
+					if (len == 0) return -3; //名前が存在しない
+					return 0; //属性処理・内容処理
+				case '=':
+					len = pos - start;
+					++pos;
+					if (len == 0) return -3; //名前が存在しない
+					return 3;
+				case '>':
+					len = pos - start;
+					++pos;
+					return 1; //内容処理
+				case '/':
+					if (xml[pos+1] != '>') return -1;
+					len = pos - start;
+					pos += 2;
+					if (len == 0) return -3; //名前が存在しない
+					return 2; // "/>" ノード処理終了
+				case '?':
+					if (xml[pos+1] != '>') return -1;
+					len = pos - start;
+					pos += 2;
+					return 4; //pi終了
+				case ';': case ':': case ',': case '&':
+					return -2; //禁止文字
+				default:
+					break;
+			}
+		}
+		return -1;
+	}
+	template <int F>
+	int parse_attribute(const xml_source<T>& xml, size_t& pos, xml_node<T>* node) {
+		size_t name_start = 0, name_len = 0;
+		int err;
+		//属性
+		int attr_mode = 0; //0 = name, 1=equal, 2=value_1, 3=value_2
+		while (pos < xml.size()) {
+			//終了判定
+			if (attr_mode < 4) {
+				if (xml[pos] == '>') {
+					if (name_len != 0) return -1; //作成途中の属性がある
+					++pos;
+					return 0;
+				} else if (xml[pos] == '/') {
+					if (xml[pos+1] != '>') return -1;
+					if (name_len != 0) return -1; //作成途中の属性がある
+					pos += 2;
+					return 2; // "/>" ノード処理終了
+				}
+			}
+
+			//処理
+			if (attr_mode == 0) {
+				//空白を省略
+				switch (xml[pos]) {
+					case ' ': case '\t': case '\n': ++pos; break;
+					default: attr_mode = 1; break;
+				}
+			} else if (attr_mode == 1) {
+				//name
+				err = parse_name(xml, pos, name_start, name_len);
+				if (err < 0) return -1; //属性名の取得に失敗
+				else if (err == 3) attr_mode = 3; // '=' が存在
+				else if (err == 0) attr_mode = 2;
+				else return err;
+			} else if (attr_mode == 2) {
+				// = が見つかるまで進める
+				switch (xml[pos]) {
+					case '=': attr_mode = 3; break; //次のモードに移行
+					case ' ': case '\t': case '\n': break; //空白文字を省略
+					default: return -3; //禁止文字
+				}
+				++pos;
+			} else if (attr_mode == 3) {
+				// " が見つかるまで進める
+				switch (xml[pos]) {
+					case '\"': attr_mode = 4; break; //次のモードに移行
+					case ' ': case '\t': case '\n': break; //空白文字を省略
+					default: return -3; //禁止文字
+				}
+				++pos;
+			} else if (attr_mode == 4) {
+				//value
+				size_t start = pos; //未処理の内容の先頭
+				xml_string<T> attr_value;
+				bool decoded = false; //特殊文字を変換した
+				bool raw = false;     //特殊文字の変換を取得時まで遅らせた
+				while (1) {
+					pos = xml_scan::find(xml.data() + pos, xml.data() + xml.size(), '\"', (F & parse_no_escape) ? '\"' : '&') - xml.data(); // '"' か '&' まで進める
+					if (pos >= xml.size()) return -1;
+					if ((F & parse_no_escape) || xml[pos] == '\"') break;
+					//特殊文字
+					if (d_lazy_decode && !decoded) {
+						err = espape_skip(xml, pos); //変換後に空になる特殊文字は読み込み時に変換する
+						if (err < 0) return err;
+						if (err > 0) { if (d_stats != nullptr) ++d_entities; raw = true; continue; }
+					}
+					if (raw) xml_entity::decode_append(attr_value, xml.data() + start, pos-start); //遅らせていた特殊文字を変換
+					else attr_value.append(xml.data() + start, pos-start);
+					raw = false;
+					err = espape_decode(xml, pos, attr_value);
+					if (err < 0) return err;
+					if (d_stats != nullptr) ++d_entities;
+					start = pos;
+					decoded = true;
+				}
+				//属性登録 (同名の属性が既にあれば上書き)
+				xml_attribute<T>* attr = node->a_list.find(xml.data() + name_start, name_len);
+				if (attr == nullptr) {
+					attr = new (node->n_pool) xml_attribute<T>();
+					attr->set_name(xml.data() + name_start, name_len, node->n_atoms);
+					attr->n_parent = node;
+					node->a_list.push_back(attr);
+				}
+				if (decoded) {
+					attr_value.append(xml.data() + start, pos-start);
+					attr->o_value = attr_value;
+				} else {
+					set_text(attr->o_value, xml, start, pos-start);
+					if (raw) attr->o_value.raw();
+				}
+				++pos;
+				name_len = 0; //リセット
+				attr_mode = 0; //最初に戻る
+			}
+		}
+		return -1;
+	}
+	template <int F>
+	int parse_node(const xml_source<T>& xml, size_t& pos, xml_node<T>* parent, xml_node<T>*& node) { //<name>value 1 = 終了タグが続く
+		/*----------開始タグ----------*/
+		size_t name_start, name_len;
+		int err = parse_name(xml, pos, name_start, name_len);
+		if (err < 0)  return err;
+		else if (err == 3) return -3;
+		else if (err == 4) return -4; //pi
+		//ノード作成
+		node = parent->add_end_child(xml_string<T>(), xml_string<T>());
+		node->set_name(xml.data() + name_start, name_len, node->n_atoms);
+		if (err == 2) return 0; // "/>"
+		if (err == 0) {
+			err = parse_attribute<F>(xml, pos, node);
+			if (err < 0) return err;
+			else if (err == 2) return 0;
+		}
+		/*----------開始タグ----------*/
+		//内容
+		xml_string<T> node_value;
+		if (F & parse_trim) while (pos < xml.size() && xml_scan::is_space(xml[pos])) ++pos; //先頭の空白を省略
+		size_t start = pos; //未処理の内容の先頭
+		bool decoded = false; //特殊文字の変換・CDATAの結合を行った
+		bool raw = false;     //特殊文字の変換を取得時まで遅らせた
+		size_t end_tag;
+		// "<"が見つかるまで繰り返し
+		int value_flag = 0;
+		while (1) {
+			size_t run = pos;
+			pos = xml_scan::find(xml.data() + pos, xml.data() + xml.size(), '<', (F & parse_no_escape) ? '<' : '&') - xml.data(); // '<' か '&' まで進める
+			if (!(F & parse_trim) && value_flag == 0 && xml_scan::has_text(xml.data() + run, xml.data() + pos)) value_flag = 1; //空白以外の内容がある
+			if (pos >= xml.size()) return -1;
+			if ((F & parse_no_escape) || xml[pos] == '<') {
+				if (xml.compare(pos+1, 8, "![CDATA[") == 0) {
+					//<![CDATA[]]> (parse_no_cdataは読み飛ばし、前後の内容だけを結合する)
+					if (raw) xml_entity::decode_append(node_value, xml.data() + start, pos-start); //遅らせていた特殊文字を変換
+					else node_value.append(xml.data() + start, pos-start);
+					raw = false;
+					pos += 9;
+					end_tag = xml.find("]]>", pos); // "]]>"を検索
+					if (end_tag == string::npos) return -1; //タグの終端が存在しない
+					if (!(F & parse_no_cdata)) {
+						node_value.append(xml.data() + pos, end_tag-pos); //内容を切り取り
+						value_flag = 1;
+					}
+					pos = end_tag + 3;
+					start = pos;
+					decoded = true;
+				} else break;
+			} else if (xml[pos] == '&') {
+				//特殊文字
+				value_flag = 1;
+				if (d_lazy_decode && !decoded) {
+					err = espape_skip(xml, pos); //変換後に空になる特殊文字は読み込み時に変換する
+					if (err < 0) return err;
+					if (err > 0) { if (d_stats != nullptr) ++d_entities; raw = true; continue; }
+				}
+				if (raw) xml_entity::decode_append(node_value, xml.data() + start, pos-start);
+				else node_value.append(xml.data() + start, pos-start);
+				raw = false;
+				err = espape_decode(xml, pos, node_value);
+				if (err < 0) return err;
+				if (d_stats != nullptr) ++d_entities;
+				start = pos;
+				decoded = true;
+			}
+		}
+		if (F & parse_trim) { //末尾の空白を省略 (空白以外の内容が残れば書き込む)
+			size_t end = pos;
+			while (end > start && xml_scan::is_space(xml[end-1])) --end;
+			if (decoded || end > start) value_flag = 1;
+			if (decoded) {
+				node_value.append(xml.data() + start, end-start);
+				node->o_value = node_value;
+			} else if (value_flag == 1) {
+				set_text(node->o_value, xml, start, end-start);
+				if (raw) node->o_value.raw();
+			}
+		} else if (value_flag == 1) { //内容書き込み
+			if (decoded) {
+				node_value.append(xml.data() + start, pos-start);
+				node->o_value = node_value;
+			} else {
+				set_text(node->o_value, xml, start, pos-start);
+				if (raw) node->o_value.raw();
+			}
+		}
+		return 1;
+	}
+	int parse_end_tag(const xml_source<T>& xml, size_t& pos, xml_node<T>* node) { //</name>
+		size_t end_start, end_len;
+		int err = parse_name(xml, pos, end_start, end_len);
+		if (err < 0) return err;
+		else if (err == 4) return -4; //pi
+		if (xml.compare(end_start, end_len, node->o_name.data(), node->o_name.size()) != 0) return -5; //ノード名が違う
+		if (err == 0) {
+			// ">" まで進む
+			while (1) {
+				if (pos >= xml.size()) return -1;
+				if (xml[pos] == '>') { ++pos; break; }
+				if (xml[pos] != ' ' && xml[pos] != '\n' && xml[pos] != '\t') return -6;
+				++pos;
+			}
+		}
+		return 0;
+	}
+	template <int F>
+	int parse_comment(const xml_source<T>& xml, size_t& pos, xml_node<T>* parent) { //<!--value-->
+		size_t end_tag = xml.find("-->", pos); // "-->"を検索
+		if (end_tag == string::npos) return -1; //タグの終端が存在しない
+		if (F & parse_no_comment) { pos = end_tag + 3; return 0; } //読み飛ばす
+		xml_node<T>* node = parent->add_end_child(xml_string<T>(), xml_string<T>(), comment); //コメントタグを追加
+		set_text(node->o_value, xml, pos, end_tag-pos); //内容を切り取り
+		pos = end_tag + 3;
+		return 0;
+	}
+	template <int F>
+	int parse_doctype(const xml_source<T>& xml, size_t& pos, xml_node<T>* parent) { //<!DOCTYPE>
+		size_t start = pos;
+		size_t end_tag;
+		xml_node<T>* node;
+		while(pos < xml.size()) {
+			switch (xml[pos]) {
+				case '>':
+					//終了
+					if (F & parse_no_doctype) { ++pos; return 0; } //読み飛ばす
+					node = parent->add_end_child(xml_string<T>(), xml_string<T>(), doctype); //DOCTYPEタグを追加
+					set_text(node->o_value, xml, start, pos-start);
+					++pos;
+					return 0;
+				case '[':
+					++pos;
+					end_tag = xml.find("]", pos); // ']' を検索
+					if (end_tag == string::npos) return -1; // ']' が存在しない
+					pos = end_tag + 1;
+					break;
+				case '<': case ']': case ';': case ':': case ',': case '&':
+					//禁止文字
+					return -2;
+				default:
+					++pos;
+					break;
+			}
+		}
+		return -1;
+	}
+	template <int F>
+	int parse_pi(const xml_source<T>& xml, size_t& pos, xml_node<T>* parent) { //<?value?>
+		size_t end_tag = xml.find("?>", pos); // "?>"を検索
+		if (end_tag == string::npos) return -1; //タグの終端が存在しない
+		if (F & parse_no_pi) { pos = end_tag + 2; return 0; } //読み飛ばす
+		xml_node<T>* node = parent->add_end_child(xml_string<T>(), xml_string<T>(), pi); //PIタグを追加
+		set_text(node->o_value, xml, pos, end_tag-pos); //内容を切り取り
+		pos = end_tag + 2;
+		return 0;
+	}
+	template <int F>
+	int parse_text(const xml_source<T>& text) { //ドキュメント全体の読み込み (再帰せず、親ノードへのリンクで階層を移動する)
+		xml_node<T>* parent = &doc; //読み込み中の階層
+		size_t depth = 0;
+		size_t pos = text.find('<'); //最初のタグを検索
+		while (pos != string::npos) {
+			++pos;
+			//処理
+			int err = parse_type<F>(text, pos, parent, depth);
+			if (err < 0) { d_error_offset = pos; return err; } //失敗
+			pos = text.find('<', pos);
+		}
+		if (parent != &doc) { d_error_offset = text.size(); return -1; } //終了タグが存在しない
+		return 0;
+	}
+
+	//並列読み込み処理
+	static size_t scan_children(const xml_source<T>& xml, size_t pos, size_t target, vector<size_t>& cuts) { //ルートの内容の先頭posから最上位の子ノードの区切りを検索し、ルートの終了タグの位置を返す (判定できない場合はnpos)
+		size_t depth = 0, last = pos, end;
+		while ((pos = xml.find('<', pos)) != string::npos) {
+			if (xml.compare(pos+1, 3, "!--") == 0) {
+				if ((end = xml.find("-->", pos + 4)) == string::npos) return string::npos;
+				pos = end + 3;
+				continue;
+			} else if (xml.compare(pos+1, 8, "![CDATA[") == 0) {
+				if ((end = xml.find("]]>", pos + 9)) == string::npos) return string::npos;
+				pos = end + 3;
+				continue;
+			} else if (xml[pos+1] == '?') {
+				if ((end = xml.find("?>", pos + 2)) == string::npos) return string::npos;
+				pos = end + 2;
+				continue;
+			} else if (xml[pos+1] == '!') return string::npos; //ルート内のDOCTYPEなど
+			else if (xml[pos+1] == '/') {
+				if (depth == 0) return pos; //ルートの終了タグ
+				if ((end = xml.find('>', pos + 2)) == string::npos) return string::npos;
+				pos = end + 1;
+				--depth;
+			} else {
+				//開始タグの終端 (引用符内の'>'は除く)
+				const T* p = xml.data() + pos + 1;
+				const T* text_end = xml.data() + xml.size();
+				while ((p = xml_scan::find(p, text_end, '>', '\"')) < text_end && *p == '\"') {
+					p = xml_scan::find(p + 1, text_end, '\"', '\"');
+					if (p == text_end) return string::npos;
+					++p;
+				}
+				if (p == text_end) return string::npos;
+				pos = p - xml.data() + 1;
+				if (p[-1] != '/') ++depth;
+			}
+			if (depth == 0 && pos - last >= target) { //最上位の子ノードの後ろで区切る
+				cuts.push_back(pos);
+				last = pos;
+			}
+		}
+		return string::npos;
+	}
+	template <int F>
+	int parse_segment(const xml_source<T>& text, xml_segment& seg, size_t depth) { //区間を読み込みseg.rootの子ノードにする (区間内でタグが閉じていなければ-1)
+		xml_source<T> xml(text.data() + seg.begin, seg.end - seg.begin);
+		xml_node<T>* parent = &seg.root;
+		size_t pos = xml.find('<');
+		while (pos != string::npos) {
+			++pos;
+			if (parent == &seg.root && xml[pos] == '/') return -1; //区間の外の終了タグ
+			int err = parse_type<F>(xml, pos, parent, depth);
+			if (err < 0) return err;
+			pos = xml.find('<', pos);
+		}
+		if (parent != &seg.root) return -1;
+		return 0;
+	}
+	void adopt_segment(xml_segment& seg, xml_node<T>* parent) { //区間のノードの名前・確保先をドキュメントのものにし、最上位のノードの親をparentにする
+		xml_node<T>* node = seg.root.n_first;
+		while (node != nullptr) {
+			node->merge_name();
+			for (xml_attribute<T>* attr : node->a_list) attr->merge_name();
+			node->n_pool = &d_pool;
+			node->n_atoms = &d_atoms;
+			if (node->n_parent == &seg.root) node->n_parent = parent;
+			if (node->n_first != nullptr) { node = node->n_first; continue; }
+			while (node != parent && node->n_next == nullptr) node = node->n_parent;
+			node = (node != parent) ? node->n_next : nullptr;
+		}
+	}
+#ifdef XML_USE_THREAD
+	template <typename F>
+	static void run_parallel(size_t threads, size_t count, F f) { //f(0)~f(count-1)をthreads個のスレッドで分担して実行 (例外は最初の1つを呼び出し元で再送出)
+		atomic<size_t> next(0);
+		exception_ptr error;
+		atomic<bool> failed(false);
+		auto work = [&]() {
+			for (size_t i = next++; i < count; i = next++) {
+				try { f(i); }
+				catch (...) {
+					if (!failed.exchange(true)) error = current_exception();
+					next = count;
+				}
+			}
+		};
+		vector<thread> workers;
+		for (size_t i = 1; i < threads && i < count; i++) workers.emplace_back(work);
+		work();
+		for (thread& th : workers) th.join();
+		if (error) rethrow_exception(error);
+	}
+#endif
+	template <int F>
+	int parse_split(const xml_string<T>& text, size_t threads) { //parse_parallelの読み込み処理
+#ifdef XML_USE_THREAD
+		if (threads == 0) threads = thread::hardware_concurrency();
+		if (threads <= 1 || text.size() < parallel_min) return parse_text<F>(text);
+		xml_source<T> xml(text);
+		//ルートの開始タグまで読み込み
+		xml_node<T>* parent = &doc;
+		size_t depth = 0;
+		size_t pos = xml.find('<');
+		while (pos != string::npos && depth == 0) {
+			++pos;
+			int err = parse_type<F>(xml, pos, parent, depth);
+			if (err < 0) { d_error_offset = pos; return err; }
+			pos = xml.find('<', pos);
+		}
+		if (depth == 0) return 0;
+		//最上位の子ノードの区切りを検索し、区間ごとに読み込む
+		vector<size_t> cuts;
+		size_t end = (pos != string::npos) ? scan_children(xml, pos, text.size() / (threads * 4), cuts) : string::npos;
+		if (end != string::npos && !cuts.empty()) {
+			vector<unique_ptr<xml_segment>> segs;
+			cuts.push_back(end);
+			for (size_t i = 0, begin = pos; i < cuts.size(); begin = cuts[i++]) {
+				segs.emplace_back(new xml_segment());
+				xml_segment& seg = *segs.back();
+				seg.begin = begin;
+				seg.end = cuts[i];
+				d_pools.emplace_back(new xml_memory_pool());
+				seg.root.n_pool = d_pools.back().get();
+				seg.root.n_atoms = &seg.atoms;
+			}
+			run_parallel(threads, segs.size(), [&](size_t i) { segs[i]->err = parse_segment<F>(xml, *segs[i], depth); });
+			for (unique_ptr<xml_segment>& seg : segs) {
+				if (seg->err < 0) { //区切りの誤り・読み込みの失敗は先頭から順に読み込み直して同じ結果にする
+					for (unique_ptr<xml_segment>& s : segs) s->root.delete_all_children(); //区間の確保先はclearで解放される
+					clear();
+					return parse_text<F>(xml);
+				}
+				d_atoms.merge(seg->atoms);
+			}
+			run_parallel(threads, segs.size(), [&](size_t i) { adopt_segment(*segs[i], parent); });
+			//区間の順にparentへ連結
+			for (unique_ptr<xml_segment>& seg : segs) {
+				xml_node<T>* first = seg->root.n_first;
+				if (first == nullptr) continue;
+				if (parent->n_end != nullptr) {
+					parent->n_end->n_next = first;
+					first->n_back = parent->n_end;
+				} else parent->n_first = first;
+				parent->n_end = seg->root.n_end;
+				seg->root.n_first = nullptr;
+				seg->root.n_end = nullptr;
+			}
+			pos = end;
+		}
+		//残りを読み込み
+		while (pos != string::npos) {
+			++pos;
+			int err = parse_type<F>(xml, pos, parent, depth);
+			if (err < 0) { d_error_offset = pos; return err; }
+			pos = xml.find('<', pos);
+		}
+		if (parent != &doc) { d_error_offset = xml.size(); return -1; } //終了タグが存在しない
+		return 0;
+#else
+		(void)threads;
+		return parse_text<F>(text);
+#endif
+	}
+
+	//統計の記録
+	double stats_lap() { //前回の記録からの時間 (ms)
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		double ms = chrono::duration<double, milli>(now - d_stats_start).count();
+		d_stats_start = now;
+		return ms;
+	}
+	void stats_begin() { //計測の開始 (統計が無効なら何もしない)
+		if (d_stats == nullptr) return;
+		d_stats->clear_parse();
+		d_stats_start = chrono::steady_clock::now();
+	}
+	int stats_end(int err, size_t bytes) { //読み込みの結果とツリーの集計を記録してerrを返す
+		if (d_stats == nullptr) return err;
+		xml_stats& s = *d_stats;
+		s.parse_ms = stats_lap();
+		s.parse_bytes = bytes;
+		s.error = err;
+		s.error_offset = (err < 0) ? d_error_offset : string::npos;
+		s.entities = d_entities;
+		//プールのブロック
+		size_t blocks = d_pool.blocks();
+		s.allocated_bytes = d_pool.reserved();
+		for (const unique_ptr<xml_memory_pool>& pool : d_pools) {
+			blocks += pool->blocks();
+			s.allocated_bytes += pool->reserved();
+		}
+		s.allocations = blocks;
+		//ノード・属性 (再帰せずにたどる)
+		const size_t small = xml_string<T>().capacity(); //文字列内に保持できる大きさ
+		auto count_text = [&s, small](const xml_text<T>& text) {
+			if (text.capacity() <= small) return;
+			++s.allocations;
+			s.allocated_bytes += (text.capacity() + 1) * sizeof(T);
+		};
+		auto count_object = [&s](const void* obj, size_t size) {
+			if (xml_memory_pool::owner(obj) != nullptr) return;
+			++s.allocations;
+			s.allocated_bytes += size;
+		};
+		size_t depth = 1;
+		xml_node<T>* node = doc.n_first;
+		while (node != nullptr) {
+			switch (node->n_type) {
+				case normal: ++s.elements; if (!node->o_value.empty()) ++s.texts; break;
+				case comment: ++s.comments; break;
+				case pi: ++s.pis; break;
+				case doctype: ++s.doctypes; break;
+				default: break;
+			}
+			if (depth > s.max_depth) s.max_depth = depth;
+			count_object(node, sizeof(xml_node<T>));
+			count_text(node->o_name);
+			count_text(node->o_value);
+			s.attributes += node->a_list.size();
+			for (xml_attribute<T>* attr : node->a_list) {
+				count_object(attr, sizeof(xml_attribute<T>));
+				count_text(attr->o_name);
+				count_text(attr->o_value);
+			}
+			if (node->n_first != nullptr) { node = node->n_first; ++depth; continue; }
+			while (node != &doc && node->n_next == nullptr) { node = node->n_parent; --depth; }
+			node = (node != &doc) ? node->n_next : nullptr;
+		}
+		return err;
+	}
+	void stats_print(size_t bytes) { //書き出しの結果を記録
+		d_stats->print_ms = stats_lap();
+		d_stats->print_bytes = bytes;
+	}
+
+	//スナップショットの読み込み処理
+	int load_layout(const char* data, size_t size, bool refer) { //スナップショットからノードを作成 (refer = 内容をコピーせずにdataを参照する)
+		typedef xml_snapshot_format F;
+		F::layout l;
+		if (!F::read(data, size, sizeof(T), l)) return -9;
+		const T* strings = (const T*)l.strings;
+		vector<const xml_atom<T>*> atoms(l.head->name_count);
+		for (uint32_t i = 0; i < l.head->name_count; i++) atoms[i] = d_atoms.intern(strings + l.names[i].offset, (size_t)l.names[i].size);
+		vector<xml_node<T>*> nodes(l.head->node_count);
+		nodes[0] = &doc;
+		for (uint32_t i = 1; i < l.head->node_count; i++) { //文書順に並んでいるため、親ノードの末尾に追加していく
+			const F::node& r = l.nodes[i];
+			xml_node<T>* node = nodes[r.parent]->add_end_child(xml_string<T>(), xml_string<T>(), (xml_node_type)r.type);
+			nodes[i] = node;
+			if (r.name != F::none && (r.type == normal || r.type == pi)) node->set_atom(atoms[r.name]);
+			if (refer) node->o_value.refer(strings + r.value.offset, (size_t)r.value.size);
+			else node->o_value.assign(strings + r.value.offset, (size_t)r.value.size);
+			if (r.type != normal && r.type != pi) continue;
+			for (uint32_t j = r.attribute; j < r.attribute + r.attribute_count; j++) {
+				const F::attribute& a = l.attributes[j];
+				const xml_atom<T>* name = atoms[a.name];
+				xml_attribute<T>* attr = node->a_list.find(name);
+				if (attr == nullptr) {
+					attr = new (node->n_pool) xml_attribute<T>();
+					attr->set_atom(name);
+					attr->n_parent = node;
+					node->a_list.push_back(attr);
+				}
+				if (refer) attr->o_value.refer(strings + a.value.offset, (size_t)a.value.size);
+				else attr->o_value.assign(strings + a.value.offset, (size_t)a.value.size);
+			}
+		}
+		return 0;
+	}
+
+	//書き出し処理 (Oはxml_writer・xml_string_writerなど write(const T*, size_t) と write(T) を持つ書き出し先)
+	template <typename O>
+	static void print_ascii(O& out, const char* text, size_t len) { print_ascii(out, text, len, (T*)nullptr); } //ASCIIの文字列をTに変換して書き出し
+	template <typename O>
+	static void print_ascii(O& out, const char* text, size_t len, char*) { out.write(text, len); }
+	template <typename O, typename C>
+	static void print_ascii(O& out, const char* text, size_t len, C*) { for (size_t i = 0; i < len; i++) out.write((C)text[i]); }
+	template <typename O>
+	void print_value_out(O& out, const xml_text<T>& val) { //特殊文字を変換して書き出し (変換が不要な範囲はまとめて書き出す)
+		const T* p = val.data();
+		const T* end = p + val.size();
+		while (p < end) {
+			const T* stop = xml_scan::find_escape(p, end);
+			out.write(p, stop - p);
+			if (stop == end) break;
+			if (*stop == '&' && val.is_raw()) { //未変換の特殊文字は変換してから書き出す
+				T buf[xml_entity::max_units];
+				int len = xml_entity::decode(stop, end, buf);
+				if (len >= 0) {
+					for (int i = 0; i < len; i++) print_char_out(out, buf[i]);
+					p = stop;
+					continue;
+				}
+			}
+			print_char_out(out, *stop);
+			p = stop + 1;
+		}
+	}
+	template <typename O>
+	void print_char_out(O& out, T c) { //1文字を特殊文字を変換して書き出し
+		switch (c) {
+			case '<':  print_ascii(out, "&lt;", 4);   break;
+			case '>':  print_ascii(out, "&gt;", 4);   break;
+			case '&':  print_ascii(out, "&amp;", 5);  break;
+			case '\"': print_ascii(out, "&quot;", 6); break;
+			case '\'': print_ascii(out, "&apos;", 6); break;
+			default:   out.write(c);           break;
+		}
+	}
+	template <typename O>
+	void print_text(O& out, const xml_text<T>& val) { out.write(val.data(), val.size()); } //そのまま書き出し
+	template <typename O>
+	void print_indent(O& out, int indent, const xml_string<T>& indenttext) {
+		for (int i = 0; i < indent; i++) out.write(indenttext.data(), indenttext.size()); //インデント
+	}
+	template <typename O>
+	void print_attribute(O& out, xml_node<T>* node) {
+		for (xml_attribute<T>* attr : node->a_list) {
+			if (attr->o_name.empty() == false) {
+				out.write(' ');
+				print_text(out, attr->o_name);
+				print_ascii(out, "=\"", 2);
+				print_value_out(out, attr->o_value);
+				out.write('\"');
+			}
+		}
+	}
+	template <typename O>
+	void print_child(O& out, xml_node<T>* node, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) { //子孫ノードの書き出し
+		if (indent >= 0 && node->n_type != document) ++indent;
+		print_siblings(out, node->first_child(), nullptr, indent, indenttext, new_line);
+	}
+	template <typename O>
+	void print_siblings(O& out, xml_node<T>* first, xml_node<T>* stop, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) { //firstからstopの前までの兄弟ノードと子孫ノードの書き出し (再帰せず、親ノードへのリンクで階層を移動する)
+		if (first == stop) return;
+		xml_node<T>* node = first->n_parent;
+		xml_node<T>* child = first;
+
+		while (child != stop) {
+			bool open = false; //子ノードが続く
+			switch (child->type()) {
+				case doctype: print_doctype(out, child, indent, indenttext, new_line); break;
+				case comment: print_comment(out, child, indent, indenttext, new_line); break;
+				case normal:  open = print_normal(out, child, indent, indenttext, new_line); break;
+				case pi:      print_pi(out, child, indent, indenttext, new_line);      break;
+				default: break;
+			}
+			if (open) {
+				//子ノードの階層に移動
+				child = child->n_first;
+				if (indent >= 0) ++indent;
+				continue;
+			}
+			//次のノードがなければ親ノードを閉じて上の階層に戻る
+			while (child->n_next == nullptr) {
+				child = child->n_parent;
+				if (child == node) return;
+				if (indent >= 0) --indent;
+				print_end(out, child, indent, indenttext, new_line);
+			}
+			child = child->n_next;
+		}
+	}
+	template <typename O>
+	void print_doctype(O& out, xml_node<T>* node, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) {
+		print_indent(out, indent, indenttext);
+		print_ascii(out, "<!DOCTYPE ", 10);
+		print_text(out, node->o_value);
+		out.write('>');
+		out.write(new_line.data(), new_line.size());
+	}
+	template <typename O>
+	bool print_normal(O& out, xml_node<T>* node, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) { //true = 子ノードと終了タグが続く
+		print_indent(out, indent, indenttext);
+		out.write('<'); //開始タグ
+		print_text(out, node->o_name);
+		print_attribute(out, node);
+		if (node->o_value.empty() == false || node->first_child() != nullptr) {
+			out.write('>');
+			print_value_out(out, node->o_value);
+			if (node->n_first != nullptr) {
+				out.write(new_line.data(), new_line.size());
+				return true;
+			}
+			print_ascii(out, "</", 2); //終了タグ
+			print_text(out, node->o_name);
+			out.write('>');
+		} else print_ascii(out, "/>", 2);
+		out.write(new_line.data(), new_line.size());
+		return false;
+	}
+	template <typename O>
+	void print_end(O& out, xml_node<T>* node, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) { //子ノードを持つノードの終了タグ
+		print_indent(out, indent, indenttext);
+		print_ascii(out, "</", 2);
+		print_text(out, node->o_name);
+		out.write('>');
+		out.write(new_line.data(), new_line.size());
+	}
+	template <typename O>
+	void print_comment(O& out, xml_node<T>* node, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) {
+		print_indent(out, indent, indenttext);
+		print_ascii(out, "<!--", 4);
+		print_text(out, node->o_value);
+		print_ascii(out, "-->", 3);
+		out.write(new_line.data(), new_line.size());
+	}
+	template <typename O>
+	void print_pi(O& out, xml_node<T>* node, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) {
+		print_indent(out, indent, indenttext);
+		print_ascii(out, "<?", 2);
+		print_text(out, node->o_value);
+		print_ascii(out, "?>", 2);
+		out.write(new_line.data(), new_line.size());
+	}
+	//前回の書き出し結果を利用した書き出し (変更のない部分木は前回の結果から複写し、変更された部分木だけを書き出す)
+	void print_cached(xml_string<T>& out, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) {
+		bool reuse = d_print_ready && indent == d_print_indent && indenttext == d_print_indenttext; //設定が変われば前回の結果は使えない
+		d_print_indent = indent;
+		d_print_indenttext = indenttext;
+		const xml_string<T>& old = d_print_text;
+		if (reuse) out.reserve(old.size());
+		xml_string_writer<T> writer(out);
+		vector<size_t> old_starts(1, 0); //書き出し中の祖先ノードの前回の位置
+		vector<size_t> new_starts(1, 0); //書き出し中の祖先ノードの今回の位置
+		xml_node<T>* child = doc.n_first;
+		while (child != nullptr) {
+			size_t start = out.size();
+			bool open = false; //子ノードが続く
+			if (child->n_moved) child->touch_all(); //移動した部分木は前回の位置を使わずに書き出す
+			if (reuse && !child->n_dirty) out.append(old, old_starts.back() + child->n_print_pos, child->n_print_size); //変更のない部分木
+			else {
+				switch (child->type()) {
+					case doctype: print_doctype(writer, child, indent, indenttext, new_line); break;
+					case comment: print_comment(writer, child, indent, indenttext, new_line); break;
+					case normal:  open = print_normal(writer, child, indent, indenttext, new_line); break;
+					case pi:      print_pi(writer, child, indent, indenttext, new_line);      break;
+					default: break;
+				}
+			}
+			if (open) {
+				//子ノードの階層に移動 (位置は閉じるときに記録する)
+				old_starts.push_back(old_starts.back() + child->n_print_pos);
+				new_starts.push_back(start);
+				child = child->n_first;
+				if (indent >= 0) ++indent;
+				continue;
+			}
+			child->n_print_pos = start - new_starts.back();
+			child->n_print_size = out.size() - start;
+			child->n_dirty = false;
+			//次のノードがなければ親ノードを閉じて上の階層に戻る
+			while (child->n_next == nullptr) {
+				child = child->n_parent;
+				if (child == &doc) break;
+				if (indent >= 0) --indent;
+				print_end(writer, child, indent, indenttext, new_line);
+				old_starts.pop_back();
+				start = new_starts.back();
+				new_starts.pop_back();
+				child->n_print_pos = start - new_starts.back();
+				child->n_print_size = out.size() - start;
+				child->n_dirty = false;
+			}
+			child = (child != &doc) ? child->n_next : nullptr;
+		}
+		doc.n_dirty = false;
+		d_print_ready = true;
+	}
+	//print_cachedで書き出す大きさ (変更のない部分木は前回の大きさを使う 前回の結果・ノードの記録は変更しない)
+	size_t print_cached_size(int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) {
+		bool reuse = d_print_ready && indent == d_print_indent && indenttext == d_print_indenttext;
+		xml_size_counter<T> counter;
+		xml_node<T>* moved = nullptr; //書き出し中の移動した部分木 (print_cachedではtouch_allで書き出し直す)
+		xml_node<T>* child = doc.n_first;
+		while (child != nullptr) {
+			bool open = false;
+			if (moved == nullptr && child->n_moved) moved = child;
+			if (reuse && moved == nullptr && !child->n_dirty) counter.write(nullptr, child->n_print_size); //変更のない部分木
+			else {
+				switch (child->type()) {
+					case doctype: print_doctype(counter, child, indent, indenttext, new_line); break;
+					case comment: print_comment(counter, child, indent, indenttext, new_line); break;
+					case normal:  open = print_normal(counter, child, indent, indenttext, new_line); break;
+					case pi:      print_pi(counter, child, indent, indenttext, new_line);      break;
+					default: break;
+				}
+			}
+			if (open) {
+				child = child->n_first;
+				if (indent >= 0) ++indent;
+				continue;
+			}
+			if (child == moved) moved = nullptr;
+			while (child->n_next == nullptr) {
+				child = child->n_parent;
+				if (child == &doc) break;
+				if (indent >= 0) --indent;
+				print_end(counter, child, indent, indenttext, new_line);
+				if (child == moved) moved = nullptr;
+			}
+			child = (child != &doc) ? child->n_next : nullptr;
+		}
+		return counter.size();
+	}
+#ifdef XML_USE_THREAD
+	//並列書き出し処理
+	struct xml_print_plan { //並列書き出しの分担
+		vector<xml_node<T>*> path;  //docから分担する子ノードの親までのノード
+		vector<int> indents;        //pathの各ノードの子ノードのインデント
+		vector<xml_node<T>*> cuts;  //各区間の先頭の子ノード (最後はnullptr)
+		vector<size_t> sizes;       //各区間の書き出す大きさ
+	};
+	static const size_t print_task_min = 256 * 1024; //1つのスレッドで書き出す最小の大きさ (小さい部分木は前後とまとめて書き出す)
+
+	bool plan_print(xml_print_plan& plan, size_t threads, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) { //子ノードを区間に分け、並列化できない場合はfalse
+		//子ノードを持つ子ノードが1つだけの間は下の階層に移動 (ルート要素など)
+		xml_node<T>* node = &doc;
+		plan.path.assign(1, node);
+		plan.indents.assign(1, indent);
+		while (true) {
+			size_t count = 0;
+			xml_node<T>* inner = nullptr; //子ノードを持つ子ノード
+			size_t inner_count = 0;
+			for (xml_node<T>* child = node->n_first; child != nullptr; child = child->n_next, count++) {
+				if (child->n_type == normal && child->n_first != nullptr) { inner = child; ++inner_count; }
+			}
+			if (count >= threads * 2 || inner_count != 1) break;
+			if (indent >= 0) ++indent;
+			plan.path.push_back(inner);
+			plan.indents.push_back(indent);
+			node = inner;
+		}
+		//子ノードごとの大きさを計算し、区間に分ける
+		vector<xml_node<T>*> children;
+		for (xml_node<T>* child = node->n_first; child != nullptr; child = child->n_next) children.push_back(child);
+		if (children.size() < 2) return false;
+		vector<size_t> sizes(children.size());
+		size_t group = children.size() / (threads * 16) + 1;
+		run_parallel(threads, (children.size() + group - 1) / group, [&](size_t g) {
+			for (size_t i = g * group; i < children.size() && i < (g + 1) * group; i++) {
+				xml_size_counter<T> counter;
+				print_siblings(counter, children[i], children[i]->n_next, indent, indenttext, new_line);
+				sizes[i] = counter.size();
+			}
+		});
+		size_t total = 0;
+		for (size_t size : sizes) total += size;
+		size_t target = total / (threads * 4);
+		if (target < print_task_min) target = print_task_min;
+		size_t size = 0;
+		for (size_t i = 0; i < children.size(); i++) {
+			if (size == 0) plan.cuts.push_back(children[i]);
+			size += sizes[i];
+			if (size >= target) { plan.sizes.push_back(size); size = 0; }
+		}
+		if (size != 0) plan.sizes.push_back(size);
+		plan.cuts.push_back(nullptr);
+		return plan.sizes.size() >= 2;
+	}
+	template <typename O>
+	void print_head(O& out, const xml_print_plan& plan, const xml_string<T>& indenttext, const xml_string<T>& new_line) { //分担する子ノードの前まで
+		for (size_t i = 0; i + 1 < plan.path.size(); i++) {
+			print_siblings(out, plan.path[i]->n_first, plan.path[i+1], plan.indents[i], indenttext, new_line);
+			print_normal(out, plan.path[i+1], plan.indents[i], indenttext, new_line);
+		}
+	}
+	template <typename O>
+	void print_tail(O& out, const xml_print_plan& plan, const xml_string<T>& indenttext, const xml_string<T>& new_line) { //分担する子ノードの後ろから
+		for (size_t i = plan.path.size() - 1; i > 0; i--) {
+			print_end(out, plan.path[i], plan.indents[i-1], indenttext, new_line);
+			print_siblings(out, plan.path[i]->n_next, nullptr, plan.indents[i-1], indenttext, new_line);
+		}
+	}
+	bool print_parallel(xml_string<T>& out, size_t threads, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) { //区間ごとの書き出し位置を計算し、各スレッドが直接書き込む
+		xml_print_plan plan;
+		if (!plan_print(plan, threads, indent, indenttext, new_line)) return false;
+		xml_size_counter<T> head, tail;
+		print_head(head, plan, indenttext, new_line);
+		print_tail(tail, plan, indenttext, new_line);
+		vector<size_t> offsets(plan.sizes.size());
+		size_t total = head.size();
+		for (size_t i = 0; i < plan.sizes.size(); i++) {
+			offsets[i] = total;
+			total += plan.sizes[i];
+		}
+		out.resize(total + tail.size());
+		xml_span_writer<T> head_writer(&out[0]);
+		print_head(head_writer, plan, indenttext, new_line);
+		run_parallel(threads, plan.sizes.size(), [&](size_t i) {
+			xml_span_writer<T> writer(&out[0] + offsets[i]);
+			print_siblings(writer, plan.cuts[i], plan.cuts[i+1], plan.indents.back(), indenttext, new_line);
+		});
+		xml_span_writer<T> tail_writer(&out[0] + total);
+		print_tail(tail_writer, plan, indenttext, new_line);
+		return true;
+	}
+	bool print_parallel(xml_writer<T>& out, size_t threads, int indent, const xml_string<T>& indenttext, const xml_string<T>& new_line) { //スレッド数の2倍の区間ずつバッファに書き出し、順に出力する
+		xml_print_plan plan;
+		if (!plan_print(plan, threads, indent, indenttext, new_line)) return false;
+		print_head(out, plan, indenttext, new_line);
+		vector<xml_string<T>> buffers(threads * 2);
+		for (size_t start = 0; start < plan.sizes.size(); start += buffers.size()) {
+			size_t count = plan.sizes.size() - start;
+			if (count > buffers.size()) count = buffers.size();
+			run_parallel(threads, count, [&](size_t i) {
+				xml_string<T>& buffer = buffers[i];
+				buffer.clear();
+				buffer.reserve(plan.sizes[start + i]);
+				xml_string_writer<T> writer(buffer);
+				print_siblings(writer, plan.cuts[start + i], plan.cuts[start + i + 1], plan.indents.back(), indenttext, new_line);
+			});
+			for (size_t i = 0; i < count; i++) out.write(buffers[i].data(), buffers[i].size());
+		}
+		print_tail(out, plan, indenttext, new_line);
+		return true;
+	}
+#endif
+	xml_string<T> print_text(bool indent, const xml_string<T>& indenttext, size_t threads) { //printの書き出し処理
+		xml_string<T> out;
+		if (d_print_cache) { //前回の書き出し結果を利用 (1つのスレッドで書き出す)
+			print_cached(out, indent ? 0 : -1, indenttext, xml_string<T>(indent ? 1 : 0, '\n'));
+			d_print_text = out;
+			return out;
+		}
+#ifdef XML_USE_THREAD
+		if (threads == 0) threads = thread::hardware_concurrency();
+		if (threads > 1 && print_parallel(out, threads, indent ? 0 : -1, indenttext, xml_string<T>(indent ? 1 : 0, '\n'))) return out;
+#endif
+		out.reserve(print_size(indent, indenttext));
+		xml_string_writer<T> writer(out);
+		print_child(writer, &doc, indent ? 0 : -1, indenttext, xml_string<T>(indent ? 1 : 0, '\n'));
+		return out;
+	}
+	int print_sink(const function<bool(const char*, size_t)>& sink, bool indent, const xml_string<T>& indenttext, size_t threads) { //print_toの書き出し処理
+		xml_writer<T> writer(sink);
+		if (d_print_cache) {
+			xml_string<T> out;
+			print_cached(out, indent ? 0 : -1, indenttext, xml_string<T>(indent ? 1 : 0, '\n'));
+			d_print_text.swap(out);
+			writer.write(d_print_text.data(), d_print_text.size());
+			return writer.flush() ? 0 : -7;
+		}
+#ifdef XML_USE_THREAD
+		if (threads == 0) threads = thread::hardware_concurrency();
+		if (threads > 1 && print_parallel(writer, threads, indent ? 0 : -1, indenttext, xml_string<T>(indent ? 1 : 0, '\n'))) return writer.flush() ? 0 : -7;
+#endif
+		print_child(writer, &doc, indent ? 0 : -1, indenttext, xml_string<T>(indent ? 1 : 0, '\n'));
+		return writer.flush() ? 0 : -7;
+	}
+public:
+	xml_document() { doc.type(document); doc.n_pool = &d_pool; doc.n_atoms = &d_atoms; d_map = nullptr; d_map_size = 0; d_insitu = false; d_lazy_decode = false; d_max_depth = 0; d_print_cache = false; d_print_ready = false; d_print_indent = 0; d_error_offset = string::npos; d_stats = nullptr; d_entities = 0; }
+	xml_document(const xml_string<T>& text) { doc.type(document); doc.n_pool = &d_pool; doc.n_atoms = &d_atoms; d_map = nullptr; d_map_size = 0; d_insitu = false; d_lazy_decode = false; d_max_depth = 0; d_print_cache = false; d_print_ready = false; d_print_indent = 0; d_error_offset = string::npos; d_stats = nullptr; d_entities = 0; parse(text); }
+	~xml_document() { clear(); }
+
+	void clear() { //データの解放
+		//末端のノードから順に破棄し、最後にプールを一括で解放
+		doc.drop_index();
+		xml_node<T>* node = doc.n_first;
+		while (node != nullptr && node != &doc) {
+			if (node->n_first != nullptr) { node = node->n_first; continue; } //子ノードを先に破棄
+			xml_node<T>* parent = node->n_parent;
+			xml_node<T>* next = node->n_next;
+			parent->n_first = next;
+			for (xml_attribute<T>* attr : node->a_list) {
+				attr->n_parent = nullptr;
+				release_object(attr);
+			}
+			node->a_list.clear();
+			node->n_parent = nullptr; node->n_back = nullptr; node->n_next = nullptr;
+			release_object(node);
+			node = (next != nullptr) ? next : parent;
+		}
+		doc.n_first = nullptr;
+		doc.n_end = nullptr;
+		doc.n_dirty = true;
+		d_pool.release();
+		d_pools.clear();
+		d_atoms.clear(); //名前の表 (参照するノードはすべて破棄済み)
+		close_source();
+		d_shared.reset();
+		d_borrowed.clear();
+		d_error_offset = string::npos;
+		d_entities = 0;
+	}
+
+	xml_node<T>* get() { return &doc; }
+
+	const xml_atom<T>* atom(const xml_string<T>& name) { return d_atoms.intern(name); } //名前の表に登録した名前 (xml_nodeの検索に利用 未登録なら登録する clear・再読み込みまで有効)
+	const xml_atom<T>* find_atom(const xml_string<T>& name) const { return d_atoms.find(name); } //登録済みの名前 (登録しない 文書にない名前はnullptr)
+	xml_atom_table<T>* atoms() { return &d_atoms; }
+
+	size_t max_depth() { return d_max_depth; }
+	void max_depth(size_t depth) { d_max_depth = depth; } //読み込むノードの階層の上限 (超えた場合は-8、0 = 上限なし)
+	bool lazy_decode() { return d_lazy_decode; }
+	void lazy_decode(bool flag) { d_lazy_decode = flag; } //特殊文字を読み込み時に変換せず、value関数での最初の取得時に変換する
+	size_t error_offset() { return d_error_offset; } //直前の読み込みでエラーを検出した位置 (先頭からの文字数 エラーなしはnpos)
+	xml_stats* stats() { return d_stats; }
+	void stats(xml_stats* s) { d_stats = s; } //parse・printの度に統計をsに記録する (nullptr = 記録しない sは呼び出し側で保持する)
+	//複製
+	void share() { //内容・属性値を1つの共有バッファにまとめ、各ノードはそこを参照する (clone(out, true)の複製先はこのバッファを共有する)
+		size_t total = 0;
+		each_text([&total](xml_text<T>& text) { total += text.size(); });
+		shared_ptr<xml_string<T>> buf = make_shared<xml_string<T>>();
+		buf->reserve(total); //参照先が移動しないよう先に確保
+		each_text([&buf](xml_text<T>& text) {
+			if (text.empty()) return;
+			bool raw = text.is_raw();
+			size_t pos = buf->size();
+			buf->append(text.data(), text.size());
+			text.refer(buf->data() + pos, text.size());
+			if (raw) text.raw();
+		});
+		d_shared = buf;
+	}
+	void clone(xml_document<T>& out, bool shared = false) { //outに複製 (shared = 内容をコピーせずに共有し、outで編集した内容だけを個別に確保する)
+		if (&out == this) return;
+		out.clear();
+		if (!shared) {
+			for (xml_node<T>* node = doc.n_first; node != nullptr; node = node->n_next) node->clone(&out.doc);
+			return;
+		}
+		if (!d_shared) share(); //最初の共有で内容をまとめる (以降に編集した内容は複製ごとにコピー)
+		out.d_borrowed.push_back(d_shared);
+		const T* begin = d_shared->data();
+		const T* end = begin + d_shared->size();
+		auto copy_text = [begin, end](xml_text<T>& to, const xml_text<T>& from) {
+			if (!from.empty() && from.data() >= begin && from.data() + from.size() <= end) to.refer(from.data(), from.size()); //共有バッファはそのまま参照
+			else to.assign(from.data(), from.size());
+			if (from.is_raw()) to.raw();
+		};
+		for (xml_node<T>* node = doc.n_first; node != nullptr; node = node->n_next) node->copy_tree(&out.doc, copy_text);
+	}
+
+	bool print_cache() { return d_print_cache; }
+	void print_cache(bool flag) { //書き出し結果を保存し、次の書き出しでは変更のない部分木を複写する (falseで保存した結果を破棄)
+		if (!flag) {
+			xml_string<T>().swap(d_print_text);
+			d_print_ready = false;
+		}
+		d_print_cache = flag;
+	}
+
+	template <int F = parse_default>
+	int parse(const xml_string<T>& text) { //XMLの読み込み
+		clear(); //以前のデータを開放
+		d_insitu = false;
+		stats_begin();
+		return stats_end(parse_text<F>(text), text.size() * sizeof(T));
+	}
+	template <int F = parse_default>
+	int parse_insitu(xml_string<T> text) { //XMLの読み込み (textを保持し、名前・内容をコピーせずに参照する)
+		clear(); //以前のデータを開放
+		d_insitu = true;
+		d_source.swap(text);
+		stats_begin();
+		return stats_end(parse_text<F>(d_source), d_source.size() * sizeof(T));
+	}
+	template <int F = parse_default>
+	int parse_file(const string& path) { //ファイルの読み込み (ファイルをメモリマップし、名前・内容をコピーせずに参照する) -7 = ファイルを開けない
+		clear(); //以前のデータを開放
+		d_insitu = true;
+		const char* data;
+		size_t size;
+		stats_begin();
+		int err = open_file(path, data, size);
+		if (d_stats != nullptr) d_stats->open_ms = stats_lap();
+		if (err < 0) return stats_end(err, 0);
+		return stats_end(parse_text<F>(xml_source<T>((const T*)data, size / sizeof(T))), size); //char16_t・char32_tは実行環境のバイト順で読み込む
+	}
+	template <int F = parse_default>
+	int parse_parallel(const xml_string<T>& text, size_t threads = 0) { //XMLの読み込み (ルートの子ノードを区間に分けて複数のスレッドで読み込む threads = 0 はCPUの数)
+		clear(); //以前のデータを開放
+		d_insitu = false;
+		stats_begin();
+		return stats_end(parse_split<F>(text, threads), text.size() * sizeof(T));
+	}
+	//バイナリ形式のスナップショット
+	string snapshot() { //ツリーをスナップショットに変換 (load_snapshot・xml_snapshotで読み込む)
+		typedef xml_snapshot_format F;
+		vector<F::text> names;
+		vector<F::node> nodes;
+		vector<F::attribute> attrs;
+		xml_string<T> strings;
+		unordered_map<const xml_atom<T>*, uint32_t> atom_index;
+		unordered_map<xml_string<T>, uint32_t> name_index;
+		auto add_text = [&strings](const xml_text<T>& text) { //文字列表に追加
+			F::text t;
+			t.offset = text.empty() ? 0 : strings.size();
+			t.size = text.size();
+			if (!text.empty()) {
+				strings.append(text.data(), text.size());
+				strings += T();
+			}
+			return t;
+		};
+		auto add_value = [&strings, &add_text](const xml_text<T>& text) { //内容・属性値を文字列表に追加 (未変換の特殊文字は文字列表の側で変換し、ツリーは変更しない)
+			if (!text.is_raw()) return add_text(text);
+			F::text t;
+			t.offset = strings.size();
+			xml_entity::decode_append(strings, text.data(), text.size());
+			t.size = strings.size() - t.offset;
+			if (t.size == 0) t.offset = 0;
+			else strings += T();
+			return t;
+		};
+		auto add_name = [&](const xml_text<T>& name, const xml_atom<T>* atom) { //名前の番号 (同じ名前は1つにまとめる)
+			if (name.empty()) return F::none;
+			if (atom != nullptr) {
+				typename unordered_map<const xml_atom<T>*, uint32_t>::iterator it = atom_index.find(atom);
+				if (it != atom_index.end()) return it->second;
+			}
+			xml_string<T> key = name.str();
+			typename unordered_map<xml_string<T>, uint32_t>::iterator it = name_index.find(key);
+			uint32_t index;
+			if (it != name_index.end()) index = it->second;
+			else {
+				index = (uint32_t)names.size();
+				names.push_back(add_text(name));
+				name_index[key] = index;
+			}
+			if (atom != nullptr) atom_index[atom] = index;
+			return index;
+		};
+		//文書順にノードを並べる
+		F::node root = F::node();
+		root.type = document;
+		root.name = root.parent = root.first = root.end = root.next = root.back = F::none;
+		nodes.push_back(root);
+		vector<uint32_t> path(1, 0); //親ノードの番号
+		xml_node<T>* node = doc.n_first;
+		while (node != nullptr) {
+			uint32_t index = (uint32_t)nodes.size();
+			uint32_t parent = path.back();
+			F::node r = F::node();
+			r.type = node->n_type;
+			r.name = add_name(node->o_name, node->o_atom);
+			r.parent = parent;
+			r.first = r.end = r.next = F::none;
+			r.back = nodes[parent].end;
+			r.attribute = (uint32_t)attrs.size();
+			r.attribute_count = (uint32_t)node->a_list.size();
+			r.value = add_value(node->o_value);
+			for (xml_attribute<T>* attr : node->a_list) {
+				F::attribute a = F::attribute();
+				a.name = add_name(attr->o_name, attr->o_atom);
+				a.value = add_value(attr->o_value);
+				attrs.push_back(a);
+			}
+			if (nodes[parent].end == F::none) nodes[parent].first = index;
+			else nodes[nodes[parent].end].next = index;
+			nodes[parent].end = index;
+			nodes.push_back(r);
+			if (node->n_first != nullptr) { //子ノードの階層に移動
+				path.push_back(index);
+				node = node->n_first;
+				continue;
+			}
+			while (node != &doc && node->n_next == nullptr) { //親ノードの階層に戻る
+				node = node->n_parent;
+				path.pop_back();
+			}
+			node = (node != &doc) ? node->n_next : nullptr;
+		}
+		//書き出し
+		F::header head = F::header();
+		char_traits<char>::copy(head.magic, "XMLS", 4);
+		head.version = F::version_number;
+		head.byte_order = F::byte_order_mark;
+		head.char_size = sizeof(T);
+		head.node_count = (uint32_t)nodes.size();
+		head.attribute_count = (uint32_t)attrs.size();
+		head.name_count = (uint32_t)names.size();
+		head.string_size = strings.size();
+		string out;
+		out.reserve(sizeof(head) + names.size() * sizeof(F::text) + nodes.size() * sizeof(F::node) + attrs.size() * sizeof(F::attribute) + strings.size() * sizeof(T));
+		out.append((const char*)&head, sizeof(head));
+		if (!names.empty()) out.append((const char*)names.data(), names.size() * sizeof(F::text));
+		out.append((const char*)nodes.data(), nodes.size() * sizeof(F::node));
+		if (!attrs.empty()) out.append((const char*)attrs.data(), attrs.size() * sizeof(F::attribute));
+		out.append((const char*)strings.data(), strings.size() * sizeof(T));
+		return out;
+	}
+	int freeze(xml_snapshot<T>& out) { //読み取り専用の形式に変換 (ノード・属性を文書順の配列にして番号で連結し、名前・内容を1つの文字列の表にまとめる 変換後は複数のスレッドから参照できる)
+		return out.load(snapshot());
+	}
+	int save_snapshot(const string& path) { //スナップショットをファイルに書き出し (-7 = 書き出しに失敗)
+		string data = snapshot();
+		FILE* fp = fopen(path.c_str(), "wb");
+		if (fp == nullptr) return -7;
+		bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+		if (fclose(fp) != 0) ok = false;
+		return ok ? 0 : -7;
+	}
+	int load_snapshot(const string& data) { //スナップショットの読み込み (-9 = 形式が不正)
+		clear(); //以前のデータを開放
+		d_insitu = false;
+		int err = load_layout(data.data(), data.size(), false);
+		if (err < 0) clear();
+		return err;
+	}
+	int load_snapshot_file(const string& path) { //スナップショットのファイルの読み込み (ファイルをメモリマップし、内容をコピーせずに参照する) -7 = ファイルを開けない, -9 = 形式が不正
+		clear(); //以前のデータを開放
+		d_insitu = false;
+		const char* data;
+		size_t size;
+		int err = open_file(path, data, size);
+		if (err == 0) err = load_layout(data, size, true);
+		if (err < 0) clear();
+		return err;
+	}
+	xml_string<T> print(bool indent = true, const xml_string<T>& indenttext = xml_string<T>(1, '\t'), size_t threads = 1) { //XMLの書き出し (出力の大きさを計算して一度だけ確保する threads = 0 はCPUの数)
+		if (d_stats == nullptr) return print_text(indent, indenttext, threads);
+		d_stats_start = chrono::steady_clock::now();
+		xml_string<T> out = print_text(indent, indenttext, threads);
+		stats_print(out.size() * sizeof(T));
+		return out;
+	}
+	size_t print_size(bool indent = true, const xml_string<T>& indenttext = xml_string<T>(1, '\t')) { //printで書き出す大きさ
+		if (d_print_cache) return print_cached_size(indent ? 0 : -1, indenttext, xml_string<T>(indent ? 1 : 0, '\n'));
+		xml_size_counter<T> counter;
+		print_child(counter, &doc, indent ? 0 : -1, indenttext, xml_string<T>(indent ? 1 : 0, '\n'));
+		return counter.size();
+	}
+	//XMLを順次書き出し (出力に失敗した場合は-7)
+	//threadsは書き出しに使うスレッド数 (0 = CPUの数)
+	int print_to(const function<bool(const char*, size_t)>& sink, bool indent = true, const xml_string<T>& indenttext = xml_string<T>(1, '\t'), size_t threads = 1) { //コールバック (false = 失敗)
+		if (d_stats == nullptr) return print_sink(sink, indent, indenttext, threads);
+		size_t bytes = 0;
+		d_stats_start = chrono::steady_clock::now();
+		int err = print_sink([&sink, &bytes](const char* p, size_t len) { bytes += len; return sink(p, len); }, indent, indenttext, threads);
+		stats_print(bytes);
+		return err;
+	}
+	int print_to(ostream& os, bool indent = true, const xml_string<T>& indenttext = xml_string<T>(1, '\t'), size_t threads = 1) {
+		return print_to([&os](const char* p, size_t len) { return (bool)os.write(p, len); }, indent, indenttext, threads);
+	}
+	int print_to(FILE* fp, bool indent = true, const xml_string<T>& indenttext = xml_string<T>(1, '\t'), size_t threads = 1) {
+		return print_to([fp](const char* p, size_t len) { return fwrite(p, 1, len, fp) == len; }, indent, indenttext, threads);
+	}
+#ifdef XML_USE_POSIX
+	int print_to(int fd, bool indent = true, const xml_string<T>& indenttext = xml_string<T>(1, '\t'), size_t threads = 1) { //ファイルディスクリプタ
+		return print_to([fd](const char* p, size_t len) {
+			while (len != 0) {
+				ssize_t n = ::write(fd, p, len);
+				if (n < 0) {
+					if (errno == EINTR) continue;
+					return false;
+				}
+				p += n;
+				len -= (size_t)n;
+			}
+			return true;
+		}, indent, indenttext, threads);
+	}
+#endif
+};
+
+//SAX形式の読み込みイベント (必要な関数をオーバーライドして利用する)
+template <typename T = char>
+class xml_sax_handler {
+public:
+	virtual ~xml_sax_handler() {}
+
+	virtual void start_element(const xml_string<T>& /*name*/) {}                         //開始タグ
+	virtual void attribute(const xml_string<T>& /*name*/, const xml_string<T>& /*value*/) {}    //属性 (start_elementの直後に通知)
+	virtual void text(const xml_string<T>& /*value*/) {}                                 //内容 (長い内容は分割して通知)
+	virtual void cdata(const xml_string<T>& /*value*/) {}                                //<![CDATA[]]>
+	virtual void comment(const xml_string<T>& /*value*/) {}                              //<!---->
+	virtual void pi(const xml_string<T>& /*value*/) {}                                   //<??>
+	virtual void doctype(const xml_string<T>& /*value*/) {}                              //<!DOCTYPE>
+	virtual void end_element(const xml_string<T>& /*name*/) {}                           //終了タグ ("/>"の場合も通知)
+};
+
+//分割して届くXMLを順次読み込み、xml_sax_handlerに通知する
+template <typename T = char>
+class xml_push_parser {
+	static const size_t text_limit = 64 * 1024; //内容をまとめて通知する最大の大きさ
+
+	xml_sax_handler<T>* p_handler;
+	xml_string<T> p_buf;   //未処理の入力
+	size_t p_pos;   //p_bufの処理済みの位置
+	size_t p_scan;  //トークンの終端の検索を再開する位置
+	bool p_quote;   //p_scanの位置が属性値の中
+	xml_string<T> p_text;  //通知前の内容
+	bool p_text_flag; //p_textに空白以外の文字がある
+	vector<xml_string<T>> p_stack; //終了していない要素名
+	int p_err;      //エラー (0 = なし)
+
+	//p_posから始まるリテラルと比較 1 = 一致, 0 = 入力が足りない, -1 = 不一致
+	int match(const char* lit) {
+		size_t len = char_traits<char>::length(lit);
+		size_t avail = p_buf.size() - p_pos;
+		if (avail < len) return xml_scan::compare(p_buf.data() + p_pos, lit, avail) == 0 ? 0 : -1;
+		return xml_scan::compare(p_buf.data() + p_pos, lit, len) == 0 ? 1 : -1;
+	}
+	//p_pos + offset から termを検索 (見つからない場合は検索済みの位置を記録)
+	size_t find_end(size_t offset, const char* term) {
+		size_t start = p_pos + offset;
+		if (p_scan > start) start = p_scan;
+		size_t out = xml_source<T>(p_buf).find(term, start);
+		if (out == string::npos) {
+			size_t len = char_traits<char>::length(term);
+			p_scan = p_buf.size() >= len ? p_buf.size() - len + 1 : 0;
+		}
+		return out;
+	}
+	void flush_text() { //内容を通知
+		if (p_text_flag) p_handler->text(p_text);
+		p_text.clear();
+		p_text_flag = false;
+	}
+	void next_token(size_t pos) { p_pos = pos; p_scan = 0; p_quote = false; }
+
+	//開始タグ (p_pos = '<', end = '>')
+	int parse_start_tag(size_t end) {
+		const T* data = p_buf.data();
+		size_t pos = p_pos + 1;
+		size_t name_end = xml_scan::find_name_end(data + pos, data + end + 1) - data;
+		if (name_end == pos) return -3; //名前が存在しない
+		switch (p_buf[name_end]) {
+			case ' ': case '\t': case '\n': case '>': case '/': break;
+			case '=': return -3;
+			case '?': return -4;
+			default: return -2; //禁止文字
+		}
+		xml_string<T> name = p_buf.substr(pos, name_end - pos);
+		flush_text();
+		p_handler->start_element(name);
+		pos = name_end;
+		xml_string<T> attr_name, attr_value;
+		while (1) {
+			while (xml_scan::is_space(p_buf[pos])) ++pos; //空白を省略
+			if (p_buf[pos] == '>') { p_stack.push_back(name); break; }
+			if (p_buf[pos] == '/') {
+				if (pos + 1 != end) return -1;
+				p_handler->end_element(name); // "/>"
+				break;
+			}
+			//属性名
+			size_t attr_end = xml_scan::find_name_end(data + pos, data + end) - data;
+			if (attr_end == pos) return -1;
+			attr_name.assign(p_buf, pos, attr_end - pos);
+			pos = attr_end;
+			while (xml_scan::is_space(p_buf[pos])) ++pos;
+			if (p_buf[pos] != '=') return -3;
+			++pos;
+			while (xml_scan::is_space(p_buf[pos])) ++pos;
+			if (p_buf[pos] != '\"') return -3;
+			++pos;
+			//属性値
+			attr_value.clear();
+			while (1) {
+				size_t stop = xml_scan::find(data + pos, data + end, '\"', '&') - data;
+				attr_value.append(p_buf, pos, stop - pos);
+				pos = stop;
+				if (pos >= end) return -1;
+				if (p_buf[pos] == '\"') break;
+				int err = xml_document<T>::espape_decode(p_buf, pos, attr_value);
+				if (err < 0) return err;
+			}
+			++pos;
+			p_handler->attribute(attr_name, attr_value);
+		}
+		next_token(end + 1);
+		return 0;
+	}
+	//終了タグ (p_pos = '<', end = '>')
+	int parse_end_tag(size_t end) {
+		const T* data = p_buf.data();
+		size_t pos = p_pos + 2;
+		size_t name_end = xml_scan::find_name_end(data + pos, data + end + 1) - data;
+		for (size_t i = name_end; i < end; i++) if (!xml_scan::is_space(p_buf[i])) return -6;
+		if (p_stack.empty()) return -1;
+		if (p_buf.compare(pos, name_end - pos, p_stack.back()) != 0) return -5; //ノード名が違う
+		flush_text();
+		p_handler->end_element(p_stack.back());
+		p_stack.pop_back();
+		next_token(end + 1);
+		return 0;
+	}
+	//<!DOCTYPE> 1 = 入力が足りない
+	int parse_doctype() {
+		size_t pos = p_pos + 10;
+		while (pos < p_buf.size()) {
+			switch (p_buf[pos]) {
+				case '>':
+					flush_text();
+					p_handler->doctype(p_buf.substr(p_pos + 10, pos - p_pos - 10));
+					next_token(pos + 1);
+					return 0;
+				case '[':
+					pos = p_buf.find(']', pos + 1);
+					if (pos == string::npos) return 1;
+					++pos;
+					break;
+				case '<': case ']': case ';': case ':': case ',': case '&':
+					return -2; //禁止文字
+				default:
+					++pos;
+					break;
+			}
+		}
+		return 1;
+	}
+	//'<'から始まるトークン 1 = 入力が足りない
+	int parse_tag() {
+		size_t end;
+		int m;
+		if (p_buf.size() - p_pos < 2) return 1;
+		switch (p_buf[p_pos + 1]) {
+			case '!':
+				if ((m = match("<!--")) >= 0) {
+					if (m == 0) return 1;
+					end = find_end(4, "-->");
+					if (end == string::npos) return 1;
+					flush_text();
+					p_handler->comment(p_buf.substr(p_pos + 4, end - p_pos - 4));
+					next_token(end + 3);
+				} else if ((m = match("<![CDATA[")) >= 0) {
+					if (m == 0) return 1;
+					if (p_stack.empty()) return -1;
+					end = find_end(9, "]]>");
+					if (end == string::npos) return 1;
+					flush_text();
+					p_handler->cdata(p_buf.substr(p_pos + 9, end - p_pos - 9));
+					next_token(end + 3);
+				} else if ((m = match("<!DOCTYPE ")) >= 0) {
+					if (m == 0) return 1;
+					return parse_doctype();
+				} else return -1; //該当タグなし
+				return 0;
+			case '?':
+				end = find_end(2, "?>");
+				if (end == string::npos) return 1;
+				flush_text();
+				p_handler->pi(p_buf.substr(p_pos + 2, end - p_pos - 2));
+				next_token(end + 2);
+				return 0;
+			case '/':
+				end = find_end(2, ">");
+				if (end == string::npos) return 1;
+				return parse_end_tag(end);
+			default:
+				//属性値の中を除いて '>' を検索
+				if (p_scan < p_pos + 1) p_scan = p_pos + 1;
+				while (1) {
+					const T* data = p_buf.data();
+					end = (p_quote ? xml_scan::find(data + p_scan, data + p_buf.size(), '\"', '\"') : xml_scan::find(data + p_scan, data + p_buf.size(), '\"', '>')) - data;
+					if (end >= p_buf.size()) { p_scan = end; return 1; }
+					p_scan = end + 1;
+					if (p_buf[end] == '\"') p_quote = !p_quote;
+					else break;
+				}
+				return parse_start_tag(end);
+		}
+	}
+	bool entity_pending(size_t pos) const { //posの'&'からバッファの終端まで特殊文字に使える文字だけが続き、';'が届いていない
+		for (size_t i = pos + 1; i < p_buf.size(); i++) {
+			T c = p_buf[i];
+			if (c == ';') return false;
+			if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '#')) return false; //特殊文字に使えない文字 (変換で失敗させる)
+		}
+		return true;
+	}
+	int process(bool last) { //p_bufを可能な限り処理
+		while (p_pos < p_buf.size()) {
+			if (p_buf[p_pos] != '<') {
+				//内容
+				const T* data = p_buf.data();
+				size_t stop = xml_scan::find(data + p_pos, data + p_buf.size(), '<', '&') - data;
+				if (!p_stack.empty()) {
+					if (!p_text_flag && xml_scan::has_text(data + p_pos, data + stop)) p_text_flag = true;
+					p_text.append(p_buf, p_pos, stop - p_pos);
+				}
+				p_pos = stop;
+				if (stop < p_buf.size() && p_buf[stop] == '&') {
+					//特殊文字 (終端の ';' が届いていなければ待つ)
+					if (!last && entity_pending(stop)) break;
+					size_t size = p_text.size();
+					int err = xml_document<T>::espape_decode(p_buf, p_pos, p_text);
+					if (err < 0) return err;
+					if (p_stack.empty()) p_text.resize(size); //ルートの外側の内容は通知しない
+					else p_text_flag = true;
+				}
+				if (p_text.size() >= text_limit) flush_text(); //長い内容は分割して通知
+				continue;
+			}
+			int err = parse_tag();
+			if (err < 0) return err;
+			if (err == 1) break; //続きを待つ
+		}
+		//処理済みの部分を破棄
+		if (p_scan >= p_pos) p_scan -= p_pos;
+		else p_scan = 0;
+		p_buf.erase(0, p_pos);
+		p_pos = 0;
+		return 0;
+	}
+public:
+	xml_push_parser(xml_sax_handler<T>* handler) { p_handler = handler; reset(); }
+
+	void reset() { //最初の状態に戻す
+		p_buf.clear();
+		p_text.clear();
+		p_stack.clear();
+		p_pos = 0; p_scan = 0; p_quote = false; p_text_flag = false; p_err = 0;
+	}
+	int push(const T* data, size_t size) { //入力の追加 (0 = 成功, 負の値 = エラー)
+		if (p_err < 0) return p_err;
+		p_buf.append(data, size);
+		p_err = process(false);
+		return p_err;
+	}
+	int push(const xml_string<T>& data) { return push(data.data(), data.size()); }
+	int finish() { //入力の終了 (すべてのタグが閉じていなければエラー)
+		if (p_err < 0) return p_err;
+		p_err = process(true);
+		if (p_err == 0 && (!p_buf.empty() || !p_stack.empty())) p_err = -1;
+		return p_err;
+	}
+	size_t depth() { return p_stack.size(); } //現在の階層
+};
+
+//パスによるノードの検索 (XPathの一部: / // 名前 * [@属性] [@属性='値'] [@属性!='値'] [位置])
+//compileで解析した結果と位置の数を数える領域を保持し、評価時はメモリを確保しない (位置の条件がある場合、compileで用意した階層より深い文書では領域を広げる)
+template <typename T = char>
+class xml_query {
+	enum predicate_type {
+		has_attribute,   //[@name]
+		attribute_equal, //[@name='value']
+		attribute_not,   //[@name!='value']
+		position         //[n] (1から)
+	};
+	struct predicate {
+		predicate_type type;
+		xml_string<T> name;
+		xml_string<T> value;
+		size_t pos;
+	};
+	struct step {
+		bool descendant; //'//' (子孫のノード)
+		bool any;        //'*' (すべての名前)
+		xml_string<T> name;
+		vector<predicate> preds;
+		size_t slot; //位置の数の領域の番号 (位置の条件がない段はnpos)
+	};
+	static const size_t max_position = 4; //1段あたりの位置の条件の上限
+	static const size_t reserve_depth = 32; //compileで位置の数の領域を用意する階層
+
+	struct cursor { //階層ごとの位置の数 (同じ親ノードの判定済みの兄弟から数え続け、前の兄弟を数え直さない)
+		xml_node<T>* node; //最後に判定した兄弟
+		size_t count[max_position];
+		int result;
+	};
+	vector<step> q_steps;
+	bool q_absolute; //'/'で始まる (ドキュメントのトップから検索)
+	bool q_forward;  //子ノードを順にたどって評価 ('//'が最後の段にしかない場合)
+	size_t q_slots;  //位置の条件がある段の数
+	mutable vector<cursor> q_cursors; //位置の数 (階層 * q_slots + 段のslot 評価のたびに初期化して使い回す)
+
+	static bool is_name_char(T c) {
+		switch (c) {
+			case '/': case '[': case ']': case '@': case '=': case '!': case '\'': case '\"': case '*':
+			case ' ': case '\t': case '\n': case '\0':
+				return false;
+			default: return true;
+		}
+	}
+	static void skip_space(const xml_string<T>& path, size_t& pos) { while (pos < path.size() && xml_scan::is_space(path[pos])) ++pos; }
+	static bool parse_name(const xml_string<T>& path, size_t& pos, xml_string<T>& name) {
+		size_t start = pos;
+		while (pos < path.size() && is_name_char(path[pos])) ++pos;
+		if (pos == start) return false;
+		name = path.substr(start, pos - start);
+		return true;
+	}
+	static int parse_predicate(const xml_string<T>& path, size_t& pos, predicate& pred) { //'['の次から']'まで
+		skip_space(path, pos);
+		if (pos < path.size() && path[pos] == '@') {
+			++pos;
+			if (!parse_name(path, pos, pred.name)) return -1;
+			skip_space(path, pos);
+			pred.type = has_attribute;
+			if (pos < path.size() && (path[pos] == '=' || path[pos] == '!')) {
+				if (path[pos] == '!') {
+					if (xml_source<T>(path).compare(pos, 2, "!=") != 0) return -1;
+					pred.type = attribute_not;
+					pos += 2;
+				} else {
+					pred.type = attribute_equal;
+					++pos;
+				}
+				skip_space(path, pos);
+				if (pos >= path.size() || (path[pos] != '\'' && path[pos] != '\"')) return -1;
+				size_t end = path.find(path[pos], pos + 1);
+				if (end == string::npos) return -1;
+				pred.value = path.substr(pos + 1, end - pos - 1);
+				pos = end + 1;
+			}
+		} else {
+			size_t start = pos;
+			pred.pos = 0;
+			while (pos < path.size() && path[pos] >= '0' && path[pos] <= '9') pred.pos = pred.pos * 10 + (path[pos++] - '0');
+			if (pos == start || pred.pos == 0) return -1;
+			pred.type = position;
+		}
+		skip_space(path, pos);
+		if (pos >= path.size() || path[pos] != ']') return -1;
+		++pos;
+		return 0;
+	}
+
+	static bool test_name(xml_node<T>* node, const step& s) { return node->n_type == normal && (s.any || node->o_name == s.name); }
+	//ノードの判定 (位置の条件はcで同じ親ノードの兄弟を順に数える c = nullptrは位置の条件がない段)
+	static bool test(xml_node<T>* node, const step& s, cursor* c) {
+		if (!test_name(node, s)) return false;
+		size_t count[max_position] = {};
+		if (c == nullptr || node->n_parent == nullptr) return filter(node, s, count) > 0;
+		if (c->node == node) return c->result > 0;
+		xml_node<T>* sib = (c->node != nullptr && c->node->n_parent == node->n_parent) ? c->node->n_next : nullptr;
+		while (true) {
+			if (sib == nullptr) { *c = cursor(); sib = node->n_parent->n_first; } //別の親ノード・nodeが判定済みの兄弟より前 (最初から数える)
+			c->node = sib;
+			c->result = test_name(sib, s) ? filter(sib, s, c->count) : 0;
+			if (sib == node) return c->result > 0;
+			sib = sib->n_next;
+		}
+	}
+	static bool equal_raw(const xml_text<T>& raw, const xml_string<T>& value) { //未変換の特殊文字を1つずつ変換しながら比較 (ノードを変更せず、領域も確保しない)
+		const T* p = raw.data();
+		const T* end = p + raw.size();
+		size_t pos = 0;
+		while (p < end) {
+			if (*p == '&') {
+				const T* q = p;
+				T buf[xml_entity::max_units];
+				int n = xml_entity::decode(q, end, buf);
+				if (n >= 0) { //変換できない場合はそのまま (decode_appendと同じ)
+					if (pos + n > value.size() || char_traits<T>::compare(value.data() + pos, buf, n) != 0) return false;
+					pos += n;
+					p = q;
+					continue;
+				}
+			}
+			if (pos >= value.size() || value[pos] != *p) return false;
+			++pos;
+			++p;
+		}
+		return pos == value.size();
+	}
+	static bool test_attribute(xml_node<T>* node, const predicate& p) {
+		xml_attribute<T>* attr = node->find_attribute(p.name);
+		if (p.type == has_attribute) return attr != nullptr;
+		bool equal = false;
+		if (attr != nullptr) equal = attr->o_value.is_raw() ? equal_raw(attr->o_value, p.value) : attr->o_value == p.value;
+		return (p.type == attribute_equal) ? equal : !equal; //attribute_not (属性がない場合も含む)
+	}
+	//子ノードの判定 (位置は兄弟ごとの数countで判定 1 = 一致 0 = 不一致 -1 = 以降の兄弟も不一致)
+	static int filter(xml_node<T>* node, const step& s, size_t* count) {
+		if (node->n_type != normal) return 0;
+		size_t n = 0;
+		for (const predicate& p : s.preds) {
+			if (p.type == position) {
+				size_t c = ++count[n++];
+				if (c < p.pos) return 0;
+				if (c > p.pos) return -1;
+			} else if (!test_attribute(node, p)) return 0;
+		}
+		return 1;
+	}
+	//pre-orderでroot以下の次のノード (rootは含まない depthは階層に合わせて増減する)
+	static xml_node<T>* next_in(xml_node<T>* node, xml_node<T>* root, size_t& depth) {
+		if (node->n_first != nullptr) { ++depth; return node->n_first; }
+		while (node != root) {
+			if (node->n_next != nullptr) return node->n_next;
+			node = node->n_parent;
+			--depth;
+		}
+		return nullptr;
+	}
+	cursor* cursor_of(size_t k, size_t depth) const { //k段目の階層depthの位置の数 (位置の条件がない段はnullptr)
+		size_t slot = q_steps[k].slot;
+		if (slot == string::npos) return nullptr;
+		size_t index = depth * q_slots + slot;
+		if (index >= q_cursors.size()) q_cursors.resize((depth + 1) * 2 * q_slots, cursor()); //用意した階層より深い
+		return &q_cursors[index];
+	}
+
+	//上から評価 ctx(階層depth)の子ノード(子孫のノード)をk段目で判定し、最後の段ならfに渡す
+	template <typename F>
+	bool forward(xml_node<T>* ctx, size_t k, F& f, size_t depth) const {
+		const step& s = q_steps[k];
+		if (s.descendant) { //最後の段のみ
+			if (ctx->n_type != normal && ctx->n_type != document) return true;
+			size_t d = depth + 1;
+			for (xml_node<T>* node = ctx->n_first; node != nullptr; node = next_in(node, ctx, d)) {
+				if (test(node, s, cursor_of(k, d)) && !f(node)) return false;
+			}
+			return true;
+		}
+		size_t count[max_position] = {};
+		xml_node<T>* node = s.any ? ctx->first_child() : ctx->first_child(s.name);
+		for (; node != nullptr; node = s.any ? node->next_node() : node->next_node(s.name)) {
+			int r = filter(node, s, count);
+			if (r < 0) break;
+			if (r == 0) continue;
+			if (k + 1 == q_steps.size()) {
+				if (!f(node)) return false;
+			} else if (!forward(node, k + 1, f, depth + 1)) return false;
+		}
+		return true;
+	}
+	//下から評価 node(rootからの階層depth)がk段目に一致し、0~k-1段目がrootから続いているか
+	bool match(xml_node<T>* node, size_t k, xml_node<T>* root, size_t depth) const {
+		const step& s = q_steps[k];
+		if (!test(node, s, cursor_of(k, depth))) return false;
+		size_t d = depth;
+		for (xml_node<T>* parent = node->n_parent; parent != nullptr; parent = parent->n_parent) {
+			--d;
+			if (k == 0) {
+				if (parent == root) return true;
+			} else if (parent != root && match(parent, k - 1, root, d)) return true;
+			if (!s.descendant || parent == root) break;
+		}
+		return false;
+	}
+public:
+	xml_query() { q_absolute = false; q_forward = true; q_slots = 0; }
+	explicit xml_query(const xml_string<T>& path) { compile(path); }
+
+	int compile(const xml_string<T>& path) { //パスの解析 (0 = 成功, -1 = 構文エラー)
+		q_steps.clear();
+		q_absolute = false;
+		q_forward = true;
+		q_slots = 0;
+		q_cursors.clear();
+		size_t pos = 0;
+		bool descendant = false;
+		xml_source<T> text(path);
+		if (text.compare(0, 2, "//") == 0) { q_absolute = true; descendant = true; pos = 2; }
+		else if (text.compare(0, 1, "/") == 0) { q_absolute = true; pos = 1; }
+		else if (text.compare(0, 3, ".//") == 0) { descendant = true; pos = 3; }
+		else if (text.compare(0, 2, "./") == 0) pos = 2;
+		while (true) {
+			step s;
+			s.descendant = descendant;
+			s.any = false;
+			if (pos < path.size() && path[pos] == '*') { s.any = true; ++pos; }
+			else if (!parse_name(path, pos, s.name)) { q_steps.clear(); return -1; }
+			size_t positions = 0;
+			while (pos < path.size() && path[pos] == '[') {
+				++pos;
+				predicate p;
+				if (parse_predicate(path, pos, p) != 0 || (p.type == position && ++positions > max_position)) { q_steps.clear(); return -1; }
+				s.preds.push_back(p);
+			}
+			s.slot = (positions != 0) ? q_slots++ : string::npos;
+			q_steps.push_back(s);
+			if (pos == path.size()) break;
+			if (path[pos] != '/') { q_steps.clear(); return -1; }
+			descendant = text.compare(pos, 2, "//") == 0;
+			pos += descendant ? 2 : 1;
+		}
+		for (size_t i = 0; i + 1 < q_steps.size(); i++) if (q_steps[i].descendant) q_forward = false;
+		q_cursors.assign(reserve_depth * q_slots, cursor()); //評価時に確保しないよう先に用意する
+		return 0;
+	}
+	bool empty() const { return q_steps.empty(); } //未解析・解析に失敗
+
+	//一致したノードを文書順にfへ渡す (fがfalseを返したら終了、最後まで検索した場合はtrue)
+	//ノードの内容は変更しないが、名前の検索で子ノードの索引を作成することがある (同じ文書を複数のスレッドから同時に検索しないこと)
+	//位置の数をxml_queryに保持するため、同じxml_queryを複数のスレッドから同時に使わないこと
+	template <typename F>
+	bool each(xml_node<T>* node, F f) const {
+		if (q_steps.empty() || node == nullptr) return true;
+		xml_node<T>* root = node;
+		if (q_absolute) while (root->n_parent != nullptr) root = root->n_parent;
+		for (cursor& c : q_cursors) c.node = nullptr; //前回の評価の位置の数を破棄
+		if (q_forward) return forward(root, 0, f, 0);
+		if (root->n_type != normal && root->n_type != document) return true;
+		size_t depth = 1;
+		for (xml_node<T>* find_node = root->n_first; find_node != nullptr; find_node = next_in(find_node, root, depth)) {
+			if (match(find_node, q_steps.size() - 1, root, depth) && !f(find_node)) return false;
+		}
+		return true;
+	}
+	template <typename O>
+	O select(xml_node<T>* node, O out) const { //一致したノードを出力イテレータへ書き込む
+		each(node, [&out](xml_node<T>* n) { *out++ = n; return true; });
+		return out;
+	}
+	xml_node<T>* first(xml_node<T>* node) const { //最初に一致したノード (ない場合はnullptr)
+		xml_node<T>* out = nullptr;
+		each(node, [&out](xml_node<T>* n) { out = n; return false; });
+		return out;
+	}
+	size_t count(xml_node<T>* node) const { //一致したノードの数
+		size_t n = 0;
+		each(node, [&n](xml_node<T>*) { ++n; return true; });
+		return n;
+	}
+};
+
+//スナップショットのノード (xml_snapshotの読み取り専用の参照 xml_nodeと同じ名前の取得関数を持つ)
+template <typename T = char>
+class xml_node_view {
+	const xml_snapshot<T>* v_snap;
+	uint32_t v_index;
+
+	const xml_snapshot_format::node& record() const { return v_snap->s_layout.nodes[v_index]; }
+	xml_node_view<T> at(uint32_t index) const { return xml_node_view<T>(v_snap, index); }
+	xml_node_view<T> find(uint32_t index, const xml_string<T>& n, bool forward) const { //indexから兄弟をたどって名前が一致するノードを検索
+		uint32_t name = v_snap->name_index(n);
+		if (name == xml_snapshot_format::none) return xml_node_view<T>();
+		while (index != xml_snapshot_format::none) {
+			const xml_snapshot_format::node& r = v_snap->s_layout.nodes[index];
+			if (r.name == name) return at(index);
+			index = forward ? r.next : r.back;
+		}
+		return xml_node_view<T>();
+	}
+public:
+	xml_node_view() { v_snap = nullptr; v_index = xml_snapshot_format::none; }
+	xml_node_view(const xml_snapshot<T>* snap, uint32_t index) { v_snap = snap; v_index = index; }
+
+	explicit operator bool() const { return v_index != xml_snapshot_format::none; } //ノードが存在する
+	bool operator==(const xml_node_view<T>& node) const { return v_snap == node.v_snap && v_index == node.v_index; }
+	bool operator!=(const xml_node_view<T>& node) const { return !(*this == node); }
+	uint32_t index() const { return v_index; } //文書順の番号
+
+	//取得
+	xml_node_type type() const { return (xml_node_type)record().type; }
+	xml_string<T> name() const { return v_snap->text_of(record().name); }
+	xml_string<T> value() const { return v_snap->text_of(record().value); }
+	xml_text<T> name_text() const { return v_snap->text_ref(record().name); } //コピーせずに参照 (xml_snapshotを閉じるまで有効)
+	xml_text<T> value_text() const { return v_snap->text_ref(record().value); }
+	xml_node_view<T> parent() const { return at(record().parent); }
+	xml_node_view<T> first_child() const { return at(record().first); }
+	xml_node_view<T> first_child(const xml_string<T>& n) const { return find(record().first, n, true); }
+	xml_node_view<T> end_child() const { return at(record().end); }
+	xml_node_view<T> end_child(const xml_string<T>& n) const { return find(record().end, n, false); }
+	xml_node_view<T> next_node() const { return at(record().next); }
+	xml_node_view<T> next_node(const xml_string<T>& n) const { return find(record().next, n, true); }
+	xml_node_view<T> back_node() const { return at(record().back); }
+	xml_node_view<T> back_node(const xml_string<T>& n) const { return find(record().back, n, false); }
+	//属性取得
+	size_t attribute_size() const { return record().attribute_count; }
+	xml_attribute_view<T> attribute(size_t index) const {
+		if (index >= record().attribute_count) return xml_attribute_view<T>();
+		return xml_attribute_view<T>(v_snap, record().attribute + (uint32_t)index);
+	}
+	xml_attribute_view<T> first_attribute() const { return attribute(0); }
+	xml_attribute_view<T> end_attribute() const { return attribute(record().attribute_count - 1); }
+	xml_attribute_view<T> find_attribute(const xml_string<T>& n) const {
+		uint32_t name = v_snap->name_index(n);
+		if (name == xml_snapshot_format::none) return xml_attribute_view<T>();
+		const xml_snapshot_format::node& r = record();
+		for (uint32_t i = r.attribute; i < r.attribute + r.attribute_count; i++) {
+			if (v_snap->s_layout.attributes[i].name == name) return xml_attribute_view<T>(v_snap, i);
+		}
+		return xml_attribute_view<T>();
+	}
+};
+
+//スナップショットの属性 (xml_snapshotの読み取り専用の参照)
+template <typename T = char>
+class xml_attribute_view {
+	const xml_snapshot<T>* v_snap;
+	uint32_t v_index;
+
+	const xml_snapshot_format::attribute& record() const { return v_snap->s_layout.attributes[v_index]; }
+public:
+	xml_attribute_view() { v_snap = nullptr; v_index = xml_snapshot_format::none; }
+	xml_attribute_view(const xml_snapshot<T>* snap, uint32_t index) { v_snap = snap; v_index = index; }
+
+	explicit operator bool() const { return v_index != xml_snapshot_format::none; } //属性が存在する
+	xml_string<T> name() const { return v_snap->text_of(record().name); }
+	xml_string<T> value() const { return v_snap->text_of(record().value); }
+	xml_text<T> name_text() const { return v_snap->text_ref(record().name); } //コピーせずに参照 (xml_snapshotを閉じるまで有効)
+	xml_text<T> value_text() const { return v_snap->text_ref(record().value); }
+};
+
+//スナップショットを読み取り専用で開く (ファイルはメモリマップし、DOMを作成せずに参照する 読み込み後は複数のスレッドから参照できる)
+template <typename T = char>
+class xml_snapshot {
+	string s_buf;       //loadで受け取ったデータ
+	const char* s_map;  //openでメモリマップしたファイル
+	size_t s_map_size;
+	xml_snapshot_format::layout s_layout;
+	unordered_map<xml_string<T>, uint32_t> s_names; //名前から名前の番号
+	bool s_valid;
+
+	friend class xml_node_view<T>;
+	friend class xml_attribute_view<T>;
+
+	uint32_t name_index(const xml_string<T>& n) const {
+		typename unordered_map<xml_string<T>, uint32_t>::const_iterator it = s_names.find(n);
+		return (it != s_names.end()) ? it->second : xml_snapshot_format::none;
+	}
+	xml_string<T> text_of(uint32_t name) const {
+		if (name == xml_snapshot_format::none) return xml_string<T>();
+		return text_of(s_layout.names[name]);
+	}
+	xml_string<T> text_of(const xml_snapshot_format::text& t) const { return xml_string<T>((const T*)s_layout.strings + t.offset, (size_t)t.size); }
+	xml_text<T> text_ref(uint32_t name) const {
+		if (name == xml_snapshot_format::none) return xml_text<T>();
+		return text_ref(s_layout.names[name]);
+	}
+	xml_text<T> text_ref(const xml_snapshot_format::text& t) const { //コピーせずに参照
+		xml_text<T> out;
+		out.refer((const T*)s_layout.strings + t.offset, (size_t)t.size);
+		return out;
+	}
+	int open_layout(const char* data, size_t size) {
+		if (!xml_snapshot_format::read(data, size, sizeof(T), s_layout)) { close(); return -9; }
+		for (uint32_t i = 0; i < s_layout.head->name_count; i++) s_names[text_of(s_layout.names[i])] = i;
+		s_valid = true;
+		return 0;
+	}
+public:
+	xml_snapshot() { s_map = nullptr; s_map_size = 0; s_valid = false; }
+	xml_snapshot(const xml_snapshot&) = delete;
+	xml_snapshot& operator=(const xml_snapshot&) = delete;
+	~xml_snapshot() { close(); }
+
+	void close() { //データを解放
+		s_valid = false;
+		s_names.clear();
+		string().swap(s_buf);
+#ifdef XML_USE_POSIX
+		if (s_map != nullptr) munmap((void*)s_map, s_map_size);
+#endif
+		s_map = nullptr;
+		s_map_size = 0;
+	}
+	int load(string data) { //xml_document::snapshotで作成したデータを保持して開く (-9 = 形式が不正)
+		close();
+		s_buf.swap(data);
+		return open_layout(s_buf.data(), s_buf.size());
+	}
+	int open(const string& path) { //ファイルをメモリマップして開く (-7 = ファイルを開けない, -9 = 形式が不正)
+		close();
+#ifdef XML_USE_POSIX
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return -7;
+		struct stat st;
+		if (::fstat(fd, &st) != 0) { ::close(fd); return -7; }
+		if (st.st_size == 0) { ::close(fd); return -9; }
+		void* map = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (map == MAP_FAILED) return -7;
+		s_map = (const char*)map;
+		s_map_size = (size_t)st.st_size;
+		return open_layout(s_map, s_map_size);
+#else
+		ifstream ifs(path.c_str(), ios::binary);
+		if (!ifs) return -7;
+		s_buf.assign(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+		return open_layout(s_buf.data(), s_buf.size());
+#endif
+	}
+	bool empty() const { return !s_valid; } //開いていない
+	size_t node_size() const { return s_valid ? s_layout.head->node_count : 0; }
+	size_t attribute_size() const { return s_valid ? s_layout.head->attribute_count : 0; }
+	xml_node_view<T> get() const { return s_valid ? xml_node_view<T>(this, 0) : xml_node_view<T>(); } //ドキュメント
+	xml_node_view<T> node(size_t index) const { return (index < node_size()) ? xml_node_view<T>(this, (uint32_t)index) : xml_node_view<T>(); } //文書順の番号のノード
+};
+
+#endif //_MYXML_HPP